@@ -0,0 +1,207 @@
+#include "batch_extractor.h"
+
+BatchExtractor::BatchExtractor(LexTable *lex_table,int thread_num,const ExtractionOptions &options,const string &counter_type)
+	: scheduler(thread_num)
+{
+	this->lex_table = lex_table;
+	this->thread_num = thread_num;
+	this->options = options;
+	this->counter_type = counter_type;
+	for (int i=0;i<thread_num;i++)
+	{
+		rule_counters.push_back(create_rule_counter(counter_type));
+	}
+}
+
+BatchExtractor::~BatchExtractor()
+{
+	for (auto counter : rule_counters)
+	{
+		delete counter;
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 解析字符串输入中一个句子的k-best句法树
+ 2. 入口参数: 该句子的多行句法树，每行形如"权重 ||| 句法树"或者只有句法树
+ 3. 出口参数: 能够使用的句法树及归一化后的权重，不合法时返回false
+ 4. 算法简介: 与命令行程序读入k-best句法树文件的方式相同
+************************************************************************************* */
+bool BatchExtractor::parse_kbest_trees(const string &tree_block,vector<string> &lines_tree,vector<double> &tree_weights,string &error)
+{
+	lines_tree.clear();
+	tree_weights.clear();
+	for (string line : Split(tree_block,"\n"))
+	{
+		TrimLine(line);
+		if (line.empty())
+			continue;
+		string line_tree;
+		double weight;
+		if (!TreeStrPair::parse_kbest_line(line,options.log_tree_weights,line_tree,weight,error))
+		{
+			lines_tree.clear();
+			tree_weights.clear();
+			return false;
+		}
+		lines_tree.push_back(line_tree);
+		tree_weights.push_back(weight);
+	}
+	return TreeStrPair::select_kbest_trees(lines_tree,tree_weights,options.log_tree_weights,error);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 验证一批字符串形式的句对，并为每个句对建立抽取器
+ 2. 入口参数: 句对，错误信息的输出位置（可以为空）
+ 3. 出口参数: 与句对一一对应的抽取器，返回不合法的句子数
+ 4. 算法简介: 1-best输入用parse_sentence解析并验证，再由解析结果建立句对，不必再解析
+ 			  一次；k-best输入的各句法树叶子节点序列相同，只需用第一棵句法树验证目标端
+			  句子和词对齐。不合法的句子建立空的抽取器，保持与输入的对应关系
+************************************************************************************* */
+int BatchExtractor::create_extractors(vector<SentenceTriple> &sentences,vector<RuleExtractor*> &extractors,vector<string> *errors)
+{
+	extractors.resize(sentences.size());
+	if (errors != NULL)
+	{
+		errors->assign(sentences.size(),"");
+	}
+	int invalid_num = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(thread_num) reduction(+:invalid_num)
+	for (int i=0;i<sentences.size();i++)
+	{
+		SentenceTriple &sentence = sentences.at(i);
+		ParsedSentence parsed;
+		string error;
+		bool valid;
+		if (options.kbest_input)
+		{
+			vector<string> lines_tree;
+			vector<double> tree_weights;
+			valid = parse_kbest_trees(sentence.tree,lines_tree,tree_weights,error);
+			if (valid && !lines_tree.empty())
+			{
+				valid = TreeStrPair::parse_sentence(lines_tree.front(),sentence.str,sentence.align,parsed.tree,parsed.tgt_words,parsed.alignment,error);
+			}
+			if (valid)
+			{
+				extractors.at(i) = new RuleExtractor(lines_tree,tree_weights,sentence.str,sentence.align,&lex_table->lex_s2t,&lex_table->lex_t2s);
+			}
+		}
+		else
+		{
+			valid = TreeStrPair::parse_sentence(sentence.tree,sentence.str,sentence.align,parsed.tree,parsed.tgt_words,parsed.alignment,error);
+			if (valid)
+			{
+				extractors.at(i) = new RuleExtractor(parsed.tree,parsed.tgt_words,parsed.alignment,&lex_table->lex_s2t,&lex_table->lex_t2s);
+			}
+		}
+		if (!valid)
+		{
+			ParsedSentence empty;
+			extractors.at(i) = new RuleExtractor(empty.tree,empty.tgt_words,empty.alignment,&lex_table->lex_s2t,&lex_table->lex_t2s);
+			invalid_num++;
+			if (errors != NULL)
+			{
+				errors->at(i) = error;
+			}
+		}
+		extractors.at(i)->set_options(options);
+	}
+	return invalid_num;
+}
+
+// 验证一批已经解析好的句对，并为每个句对建立抽取器，不合法的句子建立空的抽取器
+int BatchExtractor::create_extractors(vector<ParsedSentence> &sentences,vector<RuleExtractor*> &extractors,vector<string> *errors)
+{
+	extractors.resize(sentences.size());
+	if (errors != NULL)
+	{
+		errors->assign(sentences.size(),"");
+	}
+	int invalid_num = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(thread_num) reduction(+:invalid_num)
+	for (int i=0;i<sentences.size();i++)
+	{
+		ParsedSentence &sentence = sentences.at(i);
+		string error;
+		if (TreeStrPair::check_sentence(sentence.tree,sentence.tgt_words,sentence.alignment,error))
+		{
+			extractors.at(i) = new RuleExtractor(sentence.tree,sentence.tgt_words,sentence.alignment,&lex_table->lex_s2t,&lex_table->lex_t2s);
+		}
+		else
+		{
+			ParsedSentence empty;
+			extractors.at(i) = new RuleExtractor(empty.tree,empty.tgt_words,empty.alignment,&lex_table->lex_s2t,&lex_table->lex_t2s);
+			invalid_num++;
+			if (errors != NULL)
+			{
+				errors->at(i) = error;
+			}
+		}
+		extractors.at(i)->set_options(options);
+	}
+	return invalid_num;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 抽取一批句子的规则
+ 2. 入口参数: 句对，错误信息的输出位置（可以为空）
+ 3. 出口参数: 每个句子抽取到的规则，与输入的句子一一对应，不合法的句子没有规则；
+ 			  返回不合法的句子数
+ 4. 算法简介: 不更新计数器
+************************************************************************************* */
+int BatchExtractor::extract(vector<SentenceTriple> &sentences,vector<vector<RuleRecord> > &rule_batches,vector<string> *errors)
+{
+	vector<RuleExtractor*> extractors;
+	int invalid_num = create_extractors(sentences,extractors,errors);
+	vector<RuleCounter*> no_counters;
+	rule_batches.clear();
+	rule_batches.resize(sentences.size());
+	scheduler.run(extractors,no_counters,&rule_batches);
+	return invalid_num;
+}
+
+int BatchExtractor::extract(vector<ParsedSentence> &sentences,vector<vector<RuleRecord> > &rule_batches,vector<string> *errors)
+{
+	vector<RuleExtractor*> extractors;
+	int invalid_num = create_extractors(sentences,extractors,errors);
+	vector<RuleCounter*> no_counters;
+	rule_batches.clear();
+	rule_batches.resize(sentences.size());
+	scheduler.run(extractors,no_counters,&rule_batches);
+	return invalid_num;
+}
+
+// 抽取一批句子的规则，累加到各工作线程的计数器中，返回不合法的句子数
+int BatchExtractor::count(vector<SentenceTriple> &sentences,vector<string> *errors)
+{
+	vector<RuleExtractor*> extractors;
+	int invalid_num = create_extractors(sentences,extractors,errors);
+	scheduler.run(extractors,rule_counters);
+	return invalid_num;
+}
+
+int BatchExtractor::count(vector<ParsedSentence> &sentences,vector<string> *errors)
+{
+	vector<RuleExtractor*> extractors;
+	int invalid_num = create_extractors(sentences,extractors,errors);
+	scheduler.run(extractors,rule_counters);
+	return invalid_num;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 取出到目前为止的计数结果
+ 2. 入口参数: 无
+ 3. 出口参数: 计数器，仍归BatchExtractor所有，可以调用collect_rules在内存中取出规则表
+ 4. 算法简介: 将其他工作线程的计数器合并到第一个中，并换成空的计数器，之后可以继续
+ 			  调用count累加
+************************************************************************************* */
+RuleCounter* BatchExtractor::get_counter()
+{
+	scheduler.merge_counters(rule_counters);
+	for (int i=1;i<thread_num;i++)
+	{
+		rule_counters.push_back(create_rule_counter(counter_type));
+	}
+	return rule_counters.at(0);
+}
@@ -0,0 +1,60 @@
+#ifndef BATCH_EXTRACTOR_H
+#define BATCH_EXTRACTOR_H
+#include "stdafx.h"
+#include "lex_table.h"
+#include "tree_str_pair.h"
+#include "rule_extractor.h"
+#include "rule_counter.h"
+#include "sentence_scheduler.h"
+
+// 一个句对的字符串形式，与命令行程序各输入文件中的一行相同
+struct SentenceTriple
+{
+	string tree;									// k-best输入时为该句子的多行句法树，每行形如"权重 ||| 句法树"
+	string str;
+	string align;
+};
+
+// 已经解析好的句对
+struct ParsedSentence
+{
+	ParsedTree tree;
+	vector<string> tgt_words;
+	vector<pair<int,int> > alignment;				// （源端位置，目标端位置）
+};
+
+/*
+ * 抽取库的批量接口：在内存中输入一批句对，返回每个句子的规则，或者将规则累加到
+ * 内部的计数器中，最后取出规则表。词汇翻译表只读，可以被多个BatchExtractor共享；
+ * 同一个BatchExtractor同一时刻只能被一个线程调用，其内部用thread_num个线程并行抽取。
+ * 抽取设置与命令行程序的--max-rule-size、--max-lhs-node-num、--compose和--kbest相同，
+ * k-best设置只对字符串形式的输入有效。
+ * 每个句子在抽取前用TreeStrPair的检查函数验证，不合法的句子不抽取规则，extract和count
+ * 返回不合法的句子数，errors不为空时按句子顺序给出每个句子的错误信息，合法的句子为空串。
+ */
+class BatchExtractor
+{
+	public:
+		BatchExtractor(LexTable *lex_table,int thread_num,const ExtractionOptions &options=ExtractionOptions(),const string &counter_type="map");
+		~BatchExtractor();
+		int extract(vector<SentenceTriple> &sentences,vector<vector<RuleRecord> > &rule_batches,vector<string> *errors=NULL);
+		int extract(vector<ParsedSentence> &sentences,vector<vector<RuleRecord> > &rule_batches,vector<string> *errors=NULL);
+		int count(vector<SentenceTriple> &sentences,vector<string> *errors=NULL);
+		int count(vector<ParsedSentence> &sentences,vector<string> *errors=NULL);
+		RuleCounter* get_counter();
+
+	private:
+		int create_extractors(vector<SentenceTriple> &sentences,vector<RuleExtractor*> &extractors,vector<string> *errors);
+		int create_extractors(vector<ParsedSentence> &sentences,vector<RuleExtractor*> &extractors,vector<string> *errors);
+		bool parse_kbest_trees(const string &tree_block,vector<string> &lines_tree,vector<double> &tree_weights,string &error);
+
+	private:
+		LexTable *lex_table;
+		int thread_num;
+		ExtractionOptions options;
+		string counter_type;
+		vector<RuleCounter*> rule_counters;							// 每个工作线程的计数器
+		SentenceScheduler scheduler;
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "compiled_corpus.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char CORPUS_MAGIC[8] = {'S','2','T','C','O','R','P','1'};
+const size_t CORPUS_HEADER_BYTES = 40;
+
+/**************************************************************************************
+ 1. 函数功能: 用mmap打开二进制语料
+ 2. 入口参数: 二进制语料文件
+ 3. 出口参数: 无
+ 4. 算法简介: 检查文件头给出的索引和词表的位置及大小都在文件范围内，词表的起始位置
+ 			  单调不减；句子记录在读取时再检查，打开时不必读入整个文件
+************************************************************************************* */
+CompiledCorpus::CompiledCorpus(const string &file_name)
+{
+	this->file_name = file_name;
+	int fd = open(file_name.c_str(),O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd,&st) != 0 || st.st_size < CORPUS_HEADER_BYTES)
+	{
+		cerr<<"cannot open compiled corpus "<<file_name<<endl;
+		exit(1);
+	}
+	file_size = st.st_size;
+	data = (char*)mmap(NULL,file_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		cerr<<"cannot open compiled corpus "<<file_name<<endl;
+		exit(1);
+	}
+	if (memcmp(data,CORPUS_MAGIC,8) != 0)
+		fail();
+	const unsigned long long *header = (const unsigned long long*)(data+8);
+	index_offset = header[1];
+	unsigned long long vocab_offset = header[2];
+	if (index_offset < CORPUS_HEADER_BYTES || index_offset%8 != 0 || index_offset > vocab_offset || vocab_offset%8 != 0 || vocab_offset > file_size)
+		fail();
+	if (header[0] > (vocab_offset-index_offset)/sizeof(unsigned long long) || header[3] >= (file_size-vocab_offset)/sizeof(unsigned long long) || header[3] > INT_MAX)
+		fail();
+	sentence_num = header[0];
+	record_offsets = (const unsigned long long*)(data+index_offset);
+	vocab_offsets = (const unsigned long long*)(data+vocab_offset);
+	vocab_num = header[3];
+	vocab_chars = (const char*)(vocab_offsets+vocab_num+1);
+	size_t chars_bytes = file_size-(vocab_chars-data);
+	if (vocab_offsets[0] != 0)
+		fail();
+	for (long long i=0;i<vocab_num;i++)
+	{
+		if (vocab_offsets[i+1] < vocab_offsets[i] || vocab_offsets[i+1] > chars_bytes)
+			fail();
+	}
+}
+
+void CompiledCorpus::fail()
+{
+	cerr<<"invalid compiled corpus "<<file_name<<endl;
+	exit(1);
+}
+
+CompiledCorpus::~CompiledCorpus()
+{
+	munmap(data,file_size);
+}
+
+// 返回句子记录的起始位置，记录必须完整地位于文件头和索引之间
+const int* CompiledCorpus::record(long long idx)
+{
+	unsigned long long offset = record_offsets[idx];
+	if (offset < CORPUS_HEADER_BYTES || offset%sizeof(int) != 0 || offset+3*sizeof(int) > index_offset)
+		fail();
+	const int *rec = (const int*)(data+offset);
+	if (rec[0] < 0 || rec[1] < 0 || rec[2] < 0 || rec[0] > MAX_NODE_NUM || rec[1] > MAX_SENTENCE_LEN || rec[2] > MAX_SENTENCE_LEN*MAX_SENTENCE_LEN)
+		fail();
+	if ((3+2*rec[0]+rec[1]+2*rec[2])*sizeof(int) > index_offset-offset)
+		fail();
+	return rec;
+}
+
+string CompiledCorpus::vocab_str(int id)
+{
+	if (id < 0 || id >= vocab_num)
+		fail();
+	return string(vocab_chars+vocab_offsets[id],vocab_offsets[id+1]-vocab_offsets[id]);
+}
+
+size_t CompiledCorpus::sentence_bytes(long long idx)
+{
+	const int *rec = record(idx);
+	return (3+2*rec[0]+rec[1]+2*rec[2])*sizeof(int);
+}
+
+string CompiledCorpus::sentence_key(long long idx)
+{
+	return string((const char*)record(idx),sentence_bytes(idx));
+}
+
+// 取出一个句子，只需把词表id换成字符串，不做任何文本解析
+void CompiledCorpus::get_sentence(long long idx,ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment)
+{
+	const int *rec = record(idx);
+	int node_num = rec[0];
+	int word_num = rec[1];
+	int align_num = rec[2];
+	const int *labels = rec+3;
+	const int *parents = labels+node_num;
+	const int *words = parents+node_num;
+	const int *aligns = words+word_num;
+	tree.labels.resize(node_num);
+	tree.parents.assign(parents,parents+node_num);
+	for (int i=0;i<node_num;i++)
+	{
+		tree.labels[i] = vocab_str(labels[i]);
+	}
+	tgt_words.resize(word_num);
+	for (int i=0;i<word_num;i++)
+	{
+		tgt_words[i] = vocab_str(words[i]);
+	}
+	alignment.resize(align_num);
+	for (int i=0;i<align_num;i++)
+	{
+		if (aligns[2*i] < 0 || aligns[2*i] >= MAX_SENTENCE_LEN || aligns[2*i+1] < 0 || aligns[2*i+1] >= MAX_SENTENCE_LEN)
+			fail();
+		alignment[i] = make_pair(aligns[2*i],aligns[2*i+1]);
+	}
+}
+
+static int find_or_add_word(const string &word,unordered_map<string,int> &word2id,vector<string> &vocab)
+{
+	auto it = word2id.find(word);
+	if (it != word2id.end())
+		return it->second;
+	word2id[word] = vocab.size();
+	vocab.push_back(word);
+	return vocab.size()-1;
+}
+
+static void write_bytes(FILE *fout,const void *buf,size_t len,unsigned long long &offset,const string &corpus_file)
+{
+	if (fwrite(buf,1,len,fout) != len)
+	{
+		cerr<<"cannot write compiled corpus "<<corpus_file<<endl;
+		exit(1);
+	}
+	offset += len;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将三个文本输入文件编译成二进制语料
+ 2. 入口参数: 句法树文件，目标端句子文件，词对齐文件，输出的二进制语料文件
+ 3. 出口参数: 无
+ 4. 算法简介: 逐句解析并写出句子记录，内存中只保留词表和索引；最后写出索引和词表，
+ 			  再回到文件开头写文件头
+************************************************************************************* */
+void compile_corpus(const string &tree_file,const string &str_file,const string &align_file,const string &corpus_file)
+{
+	ifstream ft(tree_file);
+	ifstream fs(str_file);
+	ifstream fa(align_file);
+	FILE *fout = fopen(corpus_file.c_str(),"wb");
+	if (fout == NULL)
+	{
+		cerr<<"cannot open compiled corpus "<<corpus_file<<endl;
+		exit(1);
+	}
+	unsigned long long offset = 0;
+	char header[CORPUS_HEADER_BYTES] = {0};
+	write_bytes(fout,header,CORPUS_HEADER_BYTES,offset,corpus_file);
+	unordered_map<string,int> word2id;
+	vector<string> vocab;
+	vector<unsigned long long> record_offsets;
+	string line_tree,line_str,line_align,error;
+	ParsedTree tree;
+	vector<string> words;
+	vector<pair<int,int> > alignment;
+	vector<int> rec;
+	while(getline(ft,line_tree))
+	{
+		getline(fs,line_str);
+		getline(fa,line_align);
+		if (!TreeStrPair::parse_sentence(line_tree,line_str,line_align,tree,words,alignment,error))
+		{
+			cerr<<error<<", skip sentence\n";								// 写出没有句法树的记录，保持句子编号不变
+			tree.labels.clear();
+			tree.parents.clear();
+			alignment.clear();
+		}
+		rec.clear();
+		rec.push_back(tree.labels.size());
+		rec.push_back(words.size());
+		rec.push_back(alignment.size());
+		for (auto &label : tree.labels)
+		{
+			rec.push_back(find_or_add_word(label,word2id,vocab));
+		}
+		rec.insert(rec.end(),tree.parents.begin(),tree.parents.end());
+		for (auto &word : words)
+		{
+			rec.push_back(find_or_add_word(word,word2id,vocab));
+		}
+		for (auto &align : alignment)
+		{
+			rec.push_back(align.first);
+			rec.push_back(align.second);
+		}
+		record_offsets.push_back(offset);
+		write_bytes(fout,rec.data(),rec.size()*sizeof(int),offset,corpus_file);
+	}
+	if (offset%8 != 0)															// 索引按8字节对齐
+	{
+		int padding = 0;
+		write_bytes(fout,&padding,8-offset%8,offset,corpus_file);
+	}
+	unsigned long long index_offset = offset;
+	write_bytes(fout,record_offsets.data(),record_offsets.size()*sizeof(unsigned long long),offset,corpus_file);
+	unsigned long long vocab_offset = offset;
+	vector<unsigned long long> vocab_offsets(1,0);
+	for (auto &word : vocab)
+	{
+		vocab_offsets.push_back(vocab_offsets.back()+word.size());
+	}
+	write_bytes(fout,vocab_offsets.data(),vocab_offsets.size()*sizeof(unsigned long long),offset,corpus_file);
+	for (auto &word : vocab)
+	{
+		write_bytes(fout,word.data(),word.size(),offset,corpus_file);
+	}
+	unsigned long long fields[4] = {record_offsets.size(),index_offset,vocab_offset,vocab.size()};
+	if (fseek(fout,0,SEEK_SET) != 0)
+	{
+		cerr<<"cannot write compiled corpus "<<corpus_file<<endl;
+		exit(1);
+	}
+	write_bytes(fout,CORPUS_MAGIC,8,offset,corpus_file);
+	write_bytes(fout,fields,sizeof(fields),offset,corpus_file);
+	if (fclose(fout) != 0)
+	{
+		cerr<<"cannot write compiled corpus "<<corpus_file<<endl;
+		exit(1);
+	}
+	cerr<<record_offsets.size()<<" sentences, "<<vocab.size()<<" words compiled into "<<corpus_file<<endl;
+}
@@ -0,0 +1,50 @@
+#ifndef COMPILED_CORPUS_H
+#define COMPILED_CORPUS_H
+#include "stdafx.h"
+#include "myutils.h"
+#include "tree_str_pair.h"
+
+/**************************************************************************************
+ 预先解析好的二进制语料，由compile_corpus生成，用mmap读入，多次抽取实验时不必再解析文本
+ 文件格式（整数均为本机字节序）：
+ 	文件头：8字节"S2TCORP1"，uint64句子数，uint64索引的位置，uint64词表的位置，uint64词表大小
+ 	句子记录：int32节点数，int32目标端词数，int32对齐点数，int32节点标签id[节点数]，
+ 			  int32父节点编号[节点数]（先序，根节点为-1），int32目标端词id[词数]，
+ 			  int32对齐点[2*对齐点数]（源端位置，目标端位置）；句法树为空时节点数为0
+ 	索引：uint64每个句子记录的位置[句子数]
+ 	词表：uint64每个字符串的起始位置[词表大小+1]，之后是所有字符串首尾相接；句法标签、
+ 		  源端词和目标端词共用一个词表
+************************************************************************************* */
+class CompiledCorpus
+{
+	public:
+		CompiledCorpus(const string &file_name);
+		~CompiledCorpus();
+		long long size()
+		{
+			return sentence_num;
+		}
+		void get_sentence(long long idx,ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment);
+		string sentence_key(long long idx);								// 句子记录的原始字节，用作检查重复句子的键
+		size_t sentence_bytes(long long idx);
+
+	private:
+		const int* record(long long idx);
+		string vocab_str(int id);
+		void fail();
+
+	private:
+		string file_name;
+		char *data;
+		size_t file_size;
+		long long sentence_num;
+		const unsigned long long *record_offsets;
+		unsigned long long index_offset;								// 句子记录都在索引之前
+		const unsigned long long *vocab_offsets;
+		const char *vocab_chars;
+		long long vocab_num;
+};
+
+void compile_corpus(const string &tree_file,const string &str_file,const string &align_file,const string &corpus_file);
+
+#endif
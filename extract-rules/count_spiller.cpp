@@ -0,0 +1,159 @@
+#include "count_spiller.h"
+#include <unistd.h>
+
+// 读入形如"源端 ||| 目标端 ||| 次数 累加的t2s词汇权重 累加的s2t词汇权重"的一行
+static bool read_spilled_count(istream &in,SpilledCount &entry)
+{
+	string line;
+	if (!getline(in,line))
+		return false;
+	size_t src_end = line.find(" ||| ");
+	size_t tgt_end = line.rfind(" ||| ");
+	entry.rule_src = line.substr(0,src_end);
+	entry.rule_tgt = line.substr(src_end+5,tgt_end-src_end-5);
+	stringstream ss(line.substr(tgt_end+5));
+	ss>>entry.stat.count>>entry.stat.acc_lex_weight_t2s>>entry.stat.acc_lex_weight_s2t;
+	return true;
+}
+
+static void write_spilled_count(ostream &out,SpilledCount &entry)
+{
+	out<<entry.rule_src<<" ||| "<<entry.rule_tgt<<" ||| "<<entry.stat.count<<" "<<entry.stat.acc_lex_weight_t2s<<" "<<entry.stat.acc_lex_weight_s2t<<"\n";
+}
+
+CountSpiller::CountSpiller(const string &spill_dir)
+{
+	this->spill_dir = spill_dir;
+}
+
+CountSpiller::~CountSpiller()
+{
+	for (auto &file_name : temp_files)
+	{
+		remove(file_name.c_str());
+	}
+}
+
+string CountSpiller::new_file_name()
+{
+	string file_name = spill_dir+"/rule_counts."+to_string(getpid())+"."+to_string(temp_files.size());
+	temp_files.push_back(file_name);
+	return file_name;
+}
+
+// 将计数器中的规则按（源端，目标端）的顺序写入一个新的临时文件，计数器随后可以释放
+void CountSpiller::spill(RuleCounter *counter)
+{
+	string file_name = new_file_name();
+	ofstream fout(file_name);
+	if (!fout.is_open())
+	{
+		cerr<<"cannot open spill file "<<file_name<<endl;
+		exit(1);
+	}
+	counter->write_counts(fout);
+	spill_files.push_back(file_name);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 归并所有溢出文件，相同的规则累加次数和词汇权重
+ 2. 入口参数: 归并结果的文件名
+ 3. 出口参数: 每个目标端和每个根节点标签的总次数
+ 4. 算法简介: 各溢出文件都按（源端，目标端）排序，用最小堆做多路归并，归并结果
+ 			  仍然有序；边归并边统计目标端和根节点标签的次数
+************************************************************************************* */
+void CountSpiller::merge_spill_files(const string &merged_file,unordered_map<string,double> &rule_tgt2count,unordered_map<string,double> &root2count)
+{
+	vector<ifstream*> fins;
+	vector<SpilledCount> heads(spill_files.size());
+	auto later = [&heads](int a,int b){
+		if (heads[a].rule_src != heads[b].rule_src)
+			return heads[a].rule_src > heads[b].rule_src;
+		return heads[a].rule_tgt > heads[b].rule_tgt;
+	};
+	priority_queue<int,vector<int>,decltype(later)> file_queue(later);
+	for (int i=0;i<spill_files.size();i++)
+	{
+		fins.push_back(new ifstream(spill_files.at(i)));
+		if (read_spilled_count(*fins.at(i),heads.at(i)))
+		{
+			file_queue.push(i);
+		}
+	}
+	ofstream fout(merged_file);
+	fout.precision(17);
+	while (!file_queue.empty())
+	{
+		int file_idx = file_queue.top();
+		file_queue.pop();
+		SpilledCount merged = heads.at(file_idx);
+		if (read_spilled_count(*fins.at(file_idx),heads.at(file_idx)))
+		{
+			file_queue.push(file_idx);
+		}
+		while (!file_queue.empty() && heads.at(file_queue.top()).rule_src == merged.rule_src && heads.at(file_queue.top()).rule_tgt == merged.rule_tgt)
+		{
+			file_idx = file_queue.top();
+			file_queue.pop();
+			merged.stat.count += heads.at(file_idx).stat.count;
+			merged.stat.acc_lex_weight_t2s += heads.at(file_idx).stat.acc_lex_weight_t2s;
+			merged.stat.acc_lex_weight_s2t += heads.at(file_idx).stat.acc_lex_weight_s2t;
+			if (read_spilled_count(*fins.at(file_idx),heads.at(file_idx)))
+			{
+				file_queue.push(file_idx);
+			}
+		}
+		write_spilled_count(fout,merged);
+		rule_tgt2count[merged.rule_tgt] += merged.stat.count;
+		root2count[merged.rule_src.substr(0,merged.rule_src.find(" "))] += merged.stat.count;
+	}
+	for (auto fin : fins)
+	{
+		delete fin;
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 输出所有规则及其概率，格式与RuleCounter::dump_rules相同
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 先多路归并所有溢出文件，再顺序读一遍归并结果；由于结果按源端排序，
+ 			  同一源端的规则连续出现，只需缓存一个源端的规则即可得到源端的次数
+************************************************************************************* */
+void CountSpiller::dump_rules()
+{
+	string merged_file = new_file_name();
+	unordered_map<string,double> rule_tgt2count;
+	unordered_map<string,double> root2count;
+	merge_spill_files(merged_file,rule_tgt2count,root2count);
+	ifstream fin(merged_file);
+	vector<SpilledCount> src_group;											// 当前源端的所有规则
+	SpilledCount entry;
+	bool has_entry = read_spilled_count(fin,entry);
+	while (has_entry || !src_group.empty())
+	{
+		if (has_entry && (src_group.empty() || entry.rule_src == src_group.back().rule_src))
+		{
+			src_group.push_back(entry);
+			has_entry = read_spilled_count(fin,entry);
+			continue;
+		}
+		double src_count = 0;
+		for (auto &rule : src_group)
+		{
+			src_count += rule.stat.count;
+		}
+		double root_count = root2count[src_group.front().rule_src.substr(0,src_group.front().rule_src.find(" "))];
+		for (auto &rule : src_group)
+		{
+			double rule_count = rule.stat.count;
+			double lex_weight_t2s = rule.stat.acc_lex_weight_t2s/rule_count;
+			double lex_weight_s2t = rule.stat.acc_lex_weight_s2t/rule_count;
+			double trans_prob_t2s = rule_count/src_count;
+			double trans_prob_s2t = rule_count/rule_tgt2count[rule.rule_tgt];
+			double root2rule_prob = rule_count/root_count;
+			cout<<rule.rule_src<<" ||| "<<rule.rule_tgt<<" ||| "<<root2rule_prob<<" "<<trans_prob_t2s<<" "<<trans_prob_s2t<<" "<<lex_weight_t2s<<" "<<lex_weight_s2t<<endl;
+		}
+		src_group.clear();
+	}
+}
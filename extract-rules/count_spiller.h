@@ -0,0 +1,37 @@
+#ifndef COUNT_SPILLER_H
+#define COUNT_SPILLER_H
+#include "stdafx.h"
+#include "rule_counter.h"
+
+// 溢出文件中的一条规则及其累加的次数和词汇权重
+struct SpilledCount
+{
+	string rule_src;
+	string rule_tgt;
+	CountAndLexWeight stat;
+};
+
+// 内存不足时将计数器中的规则次数按顺序写入临时文件，最后归并所有临时文件输出规则表
+class CountSpiller
+{
+	public:
+		CountSpiller(const string &spill_dir);
+		~CountSpiller();
+		void spill(RuleCounter *counter);
+		void dump_rules();
+		int get_spill_num()
+		{
+			return spill_files.size();
+		}
+
+	private:
+		string new_file_name();
+		void merge_spill_files(const string &merged_file,unordered_map<string,double> &rule_tgt2count,unordered_map<string,double> &root2count);
+
+	private:
+		string spill_dir;
+		vector<string> spill_files;											// 每次溢出写出的有序文件
+		vector<string> temp_files;											// 所有临时文件，析构时删除
+};
+
+#endif
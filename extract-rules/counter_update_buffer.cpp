@@ -0,0 +1,116 @@
+#include "counter_update_buffer.h"
+
+CounterUpdateBuffer::CounterUpdateBuffer()
+{
+	instance_num = 0;
+	applied_num = 0;
+}
+
+static inline unsigned long long reverse_bits(unsigned long long x)
+{
+	x = ((x>>1)&0x5555555555555555ULL)|((x&0x5555555555555555ULL)<<1);
+	x = ((x>>2)&0x3333333333333333ULL)|((x&0x3333333333333333ULL)<<2);
+	x = ((x>>4)&0x0f0f0f0f0f0f0f0fULL)|((x&0x0f0f0f0f0f0f0f0fULL)<<4);
+	return __builtin_bswap64(x);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将一个句子的规则实例加入缓冲区
+ 2. 入口参数: 规则列表，该句子在语料中重复出现的次数
+ 3. 出口参数: 无
+ 4. 算法简介: 统计量的计算与RuleCounter::update相同；键取规则指纹低64位的位反转，
+ 			  指纹表用低位选择槽位，因此按键排序即按槽位排序，与表的大小无关
+************************************************************************************* */
+void CounterUpdateBuffer::add(vector<RuleRecord> &rule_records,double multiplicity)
+{
+	for (auto &record : rule_records)
+	{
+		BufferedUpdate update;
+		Fingerprint src_fp = fingerprint_128(record.rule_src.data(),record.rule_src.size());
+		Fingerprint tgt_fp = fingerprint_128(record.rule_tgt.data(),record.rule_tgt.size());
+		update.key = reverse_bits(combine_fingerprints(src_fp,tgt_fp).lo);
+		update.src_offset = arena.size();
+		update.src_len = record.rule_src.size();
+		arena += record.rule_src;
+		update.tgt_offset = arena.size();
+		update.tgt_len = record.rule_tgt.size();
+		arena += record.rule_tgt;
+		double count = record.count*multiplicity;
+		update.stat = {count,count*record.lex_weight_s2t,count*record.lex_weight_t2s};
+		updates.push_back(update);
+	}
+	instance_num += rule_records.size();
+}
+
+bool CounterUpdateBuffer::same_rule(const BufferedUpdate &a,const BufferedUpdate &b)
+{
+	return a.key == b.key && a.src_len == b.src_len && a.tgt_len == b.tgt_len
+		   && memcmp(arena.data()+a.src_offset,arena.data()+b.src_offset,a.src_len) == 0
+		   && memcmp(arena.data()+a.tgt_offset,arena.data()+b.tgt_offset,a.tgt_len) == 0;
+}
+
+// 先比较键，键相同时再比较字符串，使相同的规则排在一起
+bool CounterUpdateBuffer::rule_less(const BufferedUpdate &a,const BufferedUpdate &b)
+{
+	if (a.key != b.key)
+		return a.key < b.key;
+	int ret = memcmp(arena.data()+a.src_offset,arena.data()+b.src_offset,min(a.src_len,b.src_len));
+	if (ret != 0 || a.src_len != b.src_len)
+		return ret != 0? ret < 0 : a.src_len < b.src_len;
+	ret = memcmp(arena.data()+a.tgt_offset,arena.data()+b.tgt_offset,min(a.tgt_len,b.tgt_len));
+	return ret != 0? ret < 0 : a.tgt_len < b.tgt_len;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将缓冲区中的规则实例写入计数器并清空缓冲区
+ 2. 入口参数: 当前工作线程的计数器
+ 3. 出口参数: 无
+ 4. 算法简介: 1) 按键的前UPDATE_PARTITION_BITS位计数排序，分到各个划分中
+ 			  2) 每个划分内排序，相同的规则相邻，合并它们的统计量
+			  3) 按划分的顺序调用update_stat，每条不同的规则只写一次
+************************************************************************************* */
+void CounterUpdateBuffer::flush(RuleCounter *counter)
+{
+	if (updates.empty())
+		return;
+	const int partition_num = 1<<UPDATE_PARTITION_BITS;
+	vector<size_t> bounds(partition_num+1,0);
+	for (auto &update : updates)
+	{
+		bounds[(update.key>>(64-UPDATE_PARTITION_BITS))+1]++;
+	}
+	for (int i=0;i<partition_num;i++)
+	{
+		bounds[i+1] += bounds[i];
+	}
+	vector<size_t> positions(bounds.begin(),bounds.end()-1);
+	partitioned.resize(updates.size());
+	for (auto &update : updates)
+	{
+		partitioned[positions[update.key>>(64-UPDATE_PARTITION_BITS)]++] = update;
+	}
+	string rule_src,rule_tgt;
+	for (int i=0;i<partition_num;i++)
+	{
+		sort(partitioned.begin()+bounds[i],partitioned.begin()+bounds[i+1],[&](const BufferedUpdate &a,const BufferedUpdate &b){return rule_less(a,b);});
+		for (size_t j=bounds[i];j<bounds[i+1];)
+		{
+			BufferedUpdate &first = partitioned[j];
+			CountAndLexWeight stat = first.stat;
+			size_t k = j+1;
+			for (;k<bounds[i+1] && same_rule(first,partitioned[k]);k++)
+			{
+				stat.count += partitioned[k].stat.count;
+				stat.acc_lex_weight_t2s += partitioned[k].stat.acc_lex_weight_t2s;
+				stat.acc_lex_weight_s2t += partitioned[k].stat.acc_lex_weight_s2t;
+			}
+			rule_src.assign(arena.data()+first.src_offset,first.src_len);
+			rule_tgt.assign(arena.data()+first.tgt_offset,first.tgt_len);
+			counter->update_stat(rule_src,rule_tgt,stat);
+			applied_num++;
+			j = k;
+		}
+	}
+	updates.clear();
+	arena.clear();
+}
@@ -0,0 +1,54 @@
+#ifndef COUNTER_UPDATE_BUFFER_H
+#define COUNTER_UPDATE_BUFFER_H
+#include "stdafx.h"
+#include "myutils.h"
+#include "rule_counter.h"
+
+// 缓存中的一条规则实例，字符串存放在缓冲区的字符串区中
+struct BufferedUpdate
+{
+	unsigned long long key;											// 规则指纹低64位的位反转，排序后与指纹表的槽位顺序一致
+	size_t src_offset;
+	size_t tgt_offset;
+	unsigned int src_len;
+	unsigned int tgt_len;
+	CountAndLexWeight stat;
+};
+
+/**************************************************************************************
+ 一个工作线程的批量计数缓冲区：先收集多个句子的规则实例，写满后按键的前几位划分，
+ 每个划分内排序并合并相同的规则，再按划分依次写入计数器；同一批中重复的规则只查一次表，
+ 且对计数器的访问集中在表的一小段内，缓存和TLB的命中率更高
+************************************************************************************* */
+class CounterUpdateBuffer
+{
+	public:
+		CounterUpdateBuffer();
+		void add(vector<RuleRecord> &rule_records,double multiplicity);
+		bool full()
+		{
+			return updates.size() >= UPDATE_BUFFER_RULES;
+		}
+		void flush(RuleCounter *counter);
+		long long get_instance_num()
+		{
+			return instance_num;
+		}
+		long long get_applied_num()
+		{
+			return applied_num;
+		}
+
+	private:
+		bool same_rule(const BufferedUpdate &a,const BufferedUpdate &b);
+		bool rule_less(const BufferedUpdate &a,const BufferedUpdate &b);
+
+	private:
+		string arena;
+		vector<BufferedUpdate> updates;
+		vector<BufferedUpdate> partitioned;
+		long long instance_num;										// 加入缓冲区的规则实例数
+		long long applied_num;										// 预聚合后实际写入计数器的次数
+};
+
+#endif
@@ -0,0 +1,350 @@
+#include "extraction_server.h"
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+ExtractionServer::ExtractionServer(LexTable *lex_table,int worker_num,const ExtractionOptions &options,bool report_counts)
+{
+	this->lex_table = lex_table;
+	this->worker_num = worker_num;
+	this->options = options;
+	this->report_counts = report_counts;
+	pthread_mutex_init(&count_mutex,NULL);
+	pthread_mutex_init(&queue_mutex,NULL);
+	pthread_cond_init(&queue_cond,NULL);
+	sentence_num = 0;
+}
+
+ExtractionServer::~ExtractionServer()
+{
+	pthread_mutex_destroy(&count_mutex);
+	pthread_mutex_destroy(&queue_mutex);
+	pthread_cond_destroy(&queue_cond);
+}
+
+// 从文件中读入一行，去掉行尾的换行符，文件已读完时返回false
+static bool read_line(FILE *fin,string &line)
+{
+	line.clear();
+	char buf[4096];
+	while (fgets(buf,sizeof(buf),fin) != NULL)
+	{
+		line += buf;
+		if (line.back() == '\n')
+		{
+			line.pop_back();
+			return true;
+		}
+	}
+	return !line.empty();
+}
+
+/**************************************************************************************
+ 1. 函数功能: 抽取一个句子的规则，生成回复
+ 2. 入口参数: 解析好的句法树，目标端单词，词对齐
+ 3. 出口参数: 回复的内容，以空行结束
+ 4. 算法简介: 每个请求使用独立的抽取器，只有更新累计次数时需要加锁
+************************************************************************************* */
+void ExtractionServer::extract_sentence(ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,string &reply)
+{
+	reply.clear();
+	__sync_fetch_and_add(&sentence_num,1);
+	if (tree.labels.empty())
+	{
+		reply += "\n";
+		return;
+	}
+	RuleExtractor rule_extractor(tree,tgt_words,alignment,&lex_table->lex_s2t,&lex_table->lex_t2s);
+	rule_extractor.set_options(options);
+	rule_extractor.extract_rules();
+	vector<RuleRecord> records;
+	rule_extractor.take_rule_records(records);
+	vector<double> total_counts(records.size());
+	if (report_counts)
+	{
+		pthread_mutex_lock(&count_mutex);
+		for (int i=0;i<records.size();i++)
+		{
+			double &total_count = rule_counts[records.at(i).rule_src+" ||| "+records.at(i).rule_tgt];
+			total_count += records.at(i).count;
+			total_counts.at(i) = total_count;
+		}
+		pthread_mutex_unlock(&count_mutex);
+	}
+	char nums[128];
+	for (int i=0;i<records.size();i++)
+	{
+		RuleRecord &record = records.at(i);
+		reply += record.rule_src+" ||| "+record.rule_tgt+" ||| ";
+		snprintf(nums,sizeof(nums),"%g %g %g",record.lex_weight_t2s,record.lex_weight_s2t,record.count);
+		reply += nums;
+		if (report_counts)
+		{
+			snprintf(nums,sizeof(nums)," ||| %g",total_counts.at(i));
+			reply += nums;
+		}
+		reply += "\n";
+	}
+	reply += "\n";
+}
+
+// 解析一个请求的三行并抽取规则，请求不合法时回复错误原因
+void ExtractionServer::answer_request(vector<string> &lines,string &reply)
+{
+	ParsedTree tree;
+	vector<string> tgt_words;
+	vector<pair<int,int> > alignment;
+	string error;
+	for (auto &line : lines)
+	{
+		TrimLine(line);
+	}
+	if (TreeStrPair::parse_sentence(lines.at(0),lines.at(1),lines.at(2),tree,tgt_words,alignment,error))
+	{
+		extract_sentence(tree,tgt_words,alignment,reply);
+	}
+	else
+	{
+		reply = "error: "+error+"\n\n";
+	}
+}
+
+// 处理一个客户端的所有请求，每个回复写完后立即刷新，使客户端不必等待缓冲区写满
+void ExtractionServer::serve_client(FILE *fin,FILE *fout)
+{
+	vector<string> lines(3);
+	string reply;
+	while (read_line(fin,lines.at(0)) && read_line(fin,lines.at(1)) && read_line(fin,lines.at(2)))
+	{
+		answer_request(lines,reply);
+		if (fwrite(reply.data(),1,reply.size(),fout) != reply.size() || fflush(fout) != 0)
+			break;															// 客户端已断开
+	}
+}
+
+void ExtractionServer::serve_stdin()
+{
+	serve_client(stdin,stdout);
+}
+
+// 将回复全部写到套接字上，客户端已断开时返回false
+static bool write_reply(int fd,const string &reply)
+{
+	size_t written = 0;
+	while (written < reply.size())
+	{
+		ssize_t n = write(fd,reply.data()+written,reply.size()-written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		written += n;
+	}
+	return true;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 工作线程，不断取出有请求等待处理的连接，处理其最早的一个请求
+ 2. 入口参数: 服务对象
+ 3. 出口参数: 无
+ 4. 算法简介: 每次只处理一个请求，处理完后若该连接还有请求则重新放回队列，因此一个
+ 			  连接不会长期占用工作线程，同一连接的请求依次处理，回复顺序与请求相同
+************************************************************************************* */
+void* ExtractionServer::worker_main(void *arg)
+{
+	ExtractionServer *server = (ExtractionServer*)arg;
+	string reply;
+	while (true)
+	{
+		pthread_mutex_lock(&server->queue_mutex);
+		while (server->ready_connections.empty())
+		{
+			pthread_cond_wait(&server->queue_cond,&server->queue_mutex);
+		}
+		ClientConnection *connection = server->ready_connections.front();
+		server->ready_connections.pop_front();
+		vector<string> lines;
+		lines.swap(connection->requests.front());
+		connection->requests.pop_front();
+		pthread_mutex_unlock(&server->queue_mutex);
+
+		server->answer_request(lines,reply);
+		bool written = write_reply(connection->fd,reply);
+
+		pthread_mutex_lock(&server->queue_mutex);
+		if (!written)														// 客户端已断开，丢弃剩余的请求
+		{
+			connection->closed = true;
+			connection->requests.clear();
+		}
+		if (!connection->requests.empty())
+		{
+			server->ready_connections.push_back(connection);
+			pthread_cond_signal(&server->queue_cond);
+		}
+		else
+		{
+			connection->busy = false;
+			if (connection->closed && write(server->wake_fds[1],"x",1) < 0)
+			{
+				cerr<<"cannot wake up the server thread\n";					// 主线程下次被唤醒时仍会关闭该连接
+			}
+		}
+		pthread_mutex_unlock(&server->queue_mutex);
+	}
+	return NULL;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 从一个连接读入数据，切分出完整的请求
+ 2. 入口参数: 连接
+ 3. 出口参数: 新读完整的请求；客户端已关闭或出错时返回false
+ 4. 算法简介: 每次只读一次，不会阻塞；最后一行没有换行符时在关闭时作为一行，与从文件
+ 			  读入时相同，不足三行的请求丢弃
+************************************************************************************* */
+bool ExtractionServer::read_requests(ClientConnection *connection,vector<vector<string> > &new_requests)
+{
+	char buf[65536];
+	ssize_t n = read(connection->fd,buf,sizeof(buf));
+	if (n < 0 && errno == EINTR)
+		return true;
+	bool open = n > 0;
+	if (open)
+	{
+		connection->buffer.append(buf,n);
+	}
+	else if (!connection->buffer.empty())
+	{
+		connection->buffer += "\n";
+	}
+	size_t line_begin = 0,line_end;
+	while ((line_end = connection->buffer.find('\n',line_begin)) != string::npos)
+	{
+		connection->lines.push_back(connection->buffer.substr(line_begin,line_end-line_begin));
+		line_begin = line_end+1;
+		if (connection->lines.size() == 3)
+		{
+			new_requests.push_back(vector<string>());
+			new_requests.back().swap(connection->lines);
+		}
+	}
+	connection->buffer.erase(0,line_begin);
+	return open;
+}
+
+// 关闭已结束且没有工作线程在处理的连接，其余未关闭的连接放入poll的列表
+void ExtractionServer::close_finished_connections(vector<pollfd> &poll_fds)
+{
+	pthread_mutex_lock(&queue_mutex);
+	for (auto it=connections.begin();it!=connections.end();)
+	{
+		ClientConnection *connection = it->second;
+		if (connection->closed && !connection->busy)
+		{
+			close(connection->fd);
+			delete connection;
+			it = connections.erase(it);
+			continue;
+		}
+		if (!connection->closed)
+		{
+			pollfd poll_fd = {connection->fd,POLLIN,0};
+			poll_fds.push_back(poll_fd);
+		}
+		it++;
+	}
+	pthread_mutex_unlock(&queue_mutex);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 在Unix域套接字上监听，直到进程被终止
+ 2. 入口参数: 套接字文件的路径，已存在时先删除
+ 3. 出口参数: 无
+ 4. 算法简介: 主线程用poll同时等待新连接和所有连接上的数据，读入完整的请求后放入该连接
+ 			  的请求队列，连接空闲时交给worker_num个工作线程之一；连接数不受工作线程数
+			  的限制，空闲的连接不占用工作线程
+************************************************************************************* */
+void ExtractionServer::serve_socket(const string &socket_path)
+{
+	signal(SIGPIPE,SIG_IGN);												// 客户端断开时写失败，而不是终止进程
+	int listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+	sockaddr_un addr;
+	memset(&addr,0,sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (listen_fd < 0 || socket_path.size() >= sizeof(addr.sun_path) || pipe(wake_fds) != 0)
+	{
+		cerr<<"cannot create socket "<<socket_path<<endl;
+		exit(1);
+	}
+	strcpy(addr.sun_path,socket_path.c_str());
+	unlink(socket_path.c_str());
+	if (bind(listen_fd,(sockaddr*)&addr,sizeof(addr)) != 0 || listen(listen_fd,SOMAXCONN) != 0)
+	{
+		cerr<<"cannot listen on socket "<<socket_path<<endl;
+		exit(1);
+	}
+	vector<pthread_t> workers(worker_num);
+	for (int i=0;i<worker_num;i++)
+	{
+		pthread_create(&workers.at(i),NULL,worker_main,this);
+	}
+	cerr<<"listening on "<<socket_path<<" with "<<worker_num<<" workers\n";
+	while (true)
+	{
+		vector<pollfd> poll_fds = {{listen_fd,POLLIN,0},{wake_fds[0],POLLIN,0}};
+		close_finished_connections(poll_fds);
+		if (poll(poll_fds.data(),poll_fds.size(),-1) < 0)
+			continue;
+		if (poll_fds.at(1).revents != 0)
+		{
+			char buf[256];
+			if (read(wake_fds[0],buf,sizeof(buf)) < 0)
+				continue;
+		}
+		for (int i=2;i<poll_fds.size();i++)
+		{
+			if (poll_fds.at(i).revents == 0)
+				continue;
+			pthread_mutex_lock(&queue_mutex);
+			ClientConnection *connection = connections.at(poll_fds.at(i).fd);	// 只有主线程释放连接，因此一定存在
+			bool closed = connection->closed;
+			pthread_mutex_unlock(&queue_mutex);
+			if (closed)
+				continue;
+			vector<vector<string> > new_requests;
+			bool open = read_requests(connection,new_requests);
+			pthread_mutex_lock(&queue_mutex);
+			for (auto &request : new_requests)
+			{
+				connection->requests.push_back(vector<string>());
+				connection->requests.back().swap(request);
+			}
+			if (!open)
+			{
+				connection->closed = true;
+			}
+			if (!connection->busy && !connection->requests.empty())
+			{
+				connection->busy = true;
+				ready_connections.push_back(connection);
+				pthread_cond_signal(&queue_cond);
+			}
+			pthread_mutex_unlock(&queue_mutex);
+		}
+		if (poll_fds.at(0).revents & POLLIN)
+		{
+			int fd = accept(listen_fd,NULL,NULL);
+			if (fd < 0)
+				continue;
+			ClientConnection *connection = new ClientConnection();
+			connection->fd = fd;
+			connection->busy = false;
+			connection->closed = false;
+			pthread_mutex_lock(&queue_mutex);
+			connections[fd] = connection;
+			pthread_mutex_unlock(&queue_mutex);
+		}
+	}
+}
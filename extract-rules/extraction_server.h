@@ -0,0 +1,66 @@
+#ifndef EXTRACTION_SERVER_H
+#define EXTRACTION_SERVER_H
+#include "stdafx.h"
+#include "lex_table.h"
+#include "rule_extractor.h"
+#include <poll.h>
+
+/**************************************************************************************
+ 常驻的规则抽取服务，词汇翻译表只加载一次
+ 每个请求为连续的三行：句法树、目标端句子、词对齐，与命令行程序各输入文件中的一行相同；
+ 回复为该句子抽取到的规则，每行"源端 ||| 目标端 ||| t2s词汇权重 s2t词汇权重 次数"，
+ 开启累计计数时行末再加" ||| 到目前为止该规则在所有请求中的累计次数"，最后以一个空行结束；
+ 请求不合法（句法树括号不匹配、句子过长、对齐点越界等）时回复一行"error: 原因"，同样以空行结束
+ 组合规则的大小、规则左端节点数和组合方式与命令行程序相同，由启动时的抽取设置给出
+ 从标准输入读请求时只有一个客户端；监听Unix域套接字时，主线程用poll读所有连接，把读完整
+ 的请求放入队列，由工作线程池按请求处理，因此连接数不受工作线程数的限制，多个客户端的
+ 请求并行抽取；同一连接的请求依次处理，回复的顺序与请求相同
+************************************************************************************* */
+
+// 套接字上的一个客户端连接，buffer和lines只由主线程读写，requests、busy和closed由queue_mutex保护；
+// 连接只由主线程关闭和释放，此时没有工作线程在处理它
+struct ClientConnection
+{
+	int fd;
+	string buffer;													// 已读入但还不足一行的数据
+	vector<string> lines;											// 当前请求已读入的行
+	deque<vector<string> > requests;								// 读完整但尚未处理的请求
+	bool busy;														// 有工作线程正在处理该连接的请求
+	bool closed;													// 客户端已关闭或出错，不再读入新的请求
+};
+class ExtractionServer
+{
+	public:
+		ExtractionServer(LexTable *lex_table,int worker_num,const ExtractionOptions &options,bool report_counts);
+		~ExtractionServer();
+		void serve_stdin();
+		void serve_socket(const string &socket_path);
+		long long get_sentence_num()
+		{
+			return sentence_num;
+		}
+
+	private:
+		static void* worker_main(void *arg);
+		void serve_client(FILE *fin,FILE *fout);
+		void answer_request(vector<string> &lines,string &reply);
+		bool read_requests(ClientConnection *connection,vector<vector<string> > &new_requests);
+		void close_finished_connections(vector<pollfd> &poll_fds);
+		void extract_sentence(ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,string &reply);
+
+	private:
+		LexTable *lex_table;
+		int worker_num;
+		ExtractionOptions options;										// 每个请求的抽取器都使用同样的设置
+		bool report_counts;												// 回复中是否带有规则的累计次数
+		unordered_map<string,double> rule_counts;						// 所有请求中每条规则的累计次数
+		pthread_mutex_t count_mutex;
+		map<int,ClientConnection*> connections;							// 所有未关闭的连接，以fd为键
+		deque<ClientConnection*> ready_connections;						// 有请求等待处理且没有工作线程在处理的连接
+		pthread_mutex_t queue_mutex;
+		pthread_cond_t queue_cond;
+		int wake_fds[2];												// 工作线程处理完已关闭的连接后通过该管道唤醒主线程
+		long long sentence_num;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "fingerprint_rule_counter.h"
+#include "rule_table_writer.h"
+
+FingerprintRuleCounter::FingerprintRuleCounter()
+{
+    src_offsets.push_back(0);
+    tgt_offsets.push_back(0);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 更新一条规则的计数
+ 2. 入口参数: 规则源端，规则目标端，已乘过次数的统计量
+ 3. 出口参数: 无
+ 4. 算法简介: 源端和目标端各计算一次指纹，规则的指纹由二者组合得到，不需要拼接字符串；
+ 			  每张表的查找只需一次哈希探测和16字节的比较
+************************************************************************************* */
+void FingerprintRuleCounter::update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat)
+{
+    Fingerprint src_fp = fingerprint_128(rule_src.data(),rule_src.size());
+    Fingerprint tgt_fp = fingerprint_128(rule_tgt.data(),rule_tgt.size());
+    int src_id = find_or_add_src(src_fp,rule_src.data(),rule_src.size());
+    int tgt_id = find_or_add_tgt(tgt_fp,rule_tgt.data(),rule_tgt.size());
+    int rule_idx = find_or_add_rule(combine_fingerprints(src_fp,tgt_fp),src_id,tgt_id);
+    rule_stats[rule_idx].count += stat.count;
+    rule_stats[rule_idx].acc_lex_weight_t2s += stat.acc_lex_weight_t2s;
+    rule_stats[rule_idx].acc_lex_weight_s2t += stat.acc_lex_weight_s2t;
+    src_counts[src_id] += stat.count;
+    tgt_counts[tgt_id] += stat.count;
+    root_counts[src_root_ids[src_id]] += stat.count;
+}
+
+int FingerprintRuleCounter::find_or_add_src(const Fingerprint &fp,const char *text,size_t len)
+{
+    bool is_new;
+    int src_id = src_table.find_or_add(fp,is_new);
+    if (is_new)
+    {
+        src_arena.insert(src_arena.end(),text,text+len);
+        src_offsets.push_back(src_arena.size());
+        src_counts.push_back(0);
+        string root(text,find(text,text+len,' ')-text);
+        auto it = root2id.find(root);
+        if (it == root2id.end())
+        {
+            it = root2id.insert(make_pair(root,(int)root_counts.size())).first;
+            root_counts.push_back(0);
+        }
+        src_root_ids.push_back(it->second);
+    }
+    return src_id;
+}
+
+int FingerprintRuleCounter::find_or_add_tgt(const Fingerprint &fp,const char *text,size_t len)
+{
+    bool is_new;
+    int tgt_id = tgt_table.find_or_add(fp,is_new);
+    if (is_new)
+    {
+        tgt_arena.insert(tgt_arena.end(),text,text+len);
+        tgt_offsets.push_back(tgt_arena.size());
+        tgt_counts.push_back(0);
+    }
+    return tgt_id;
+}
+
+int FingerprintRuleCounter::find_or_add_rule(const Fingerprint &fp,int src_id,int tgt_id)
+{
+    bool is_new;
+    int rule_idx = rule_table.find_or_add(fp,is_new);
+    if (is_new)
+    {
+        rule_src_ids.push_back(src_id);
+        rule_tgt_ids.push_back(tgt_id);
+        rule_stats.push_back({0,0,0});
+    }
+    return rule_idx;
+}
+
+void FingerprintRuleCounter::merge(RuleCounter &other_counter)
+{
+    FingerprintRuleCounter &other = dynamic_cast<FingerprintRuleCounter&>(other_counter);
+    vector<int> src_id_map(other.src_table.size());
+    for (int i=0;i<other.src_table.size();i++)
+    {
+        size_t offset = other.src_offsets[i];
+        src_id_map[i] = find_or_add_src(other.src_table.get(i),other.src_arena.data()+offset,other.src_offsets[i+1]-offset);
+        src_counts[src_id_map[i]] += other.src_counts[i];
+    }
+    vector<int> tgt_id_map(other.tgt_table.size());
+    for (int i=0;i<other.tgt_table.size();i++)
+    {
+        size_t offset = other.tgt_offsets[i];
+        tgt_id_map[i] = find_or_add_tgt(other.tgt_table.get(i),other.tgt_arena.data()+offset,other.tgt_offsets[i+1]-offset);
+        tgt_counts[tgt_id_map[i]] += other.tgt_counts[i];
+    }
+    for (auto &kvp : other.root2id)
+    {
+        root_counts[root2id.at(kvp.first)] += other.root_counts[kvp.second];        // 源端已合并，根节点标签必然存在
+    }
+    for (int i=0;i<other.rule_table.size();i++)
+    {
+        int rule_idx = find_or_add_rule(other.rule_table.get(i),src_id_map[other.rule_src_ids[i]],tgt_id_map[other.rule_tgt_ids[i]]);
+        rule_stats[rule_idx].count += other.rule_stats[i].count;
+        rule_stats[rule_idx].acc_lex_weight_t2s += other.rule_stats[i].acc_lex_weight_t2s;
+        rule_stats[rule_idx].acc_lex_weight_s2t += other.rule_stats[i].acc_lex_weight_s2t;
+    }
+}
+
+// 返回每个字符串按字节排序后的名次
+vector<int> FingerprintRuleCounter::sort_ids(const HugePageVector<char> &arena,const HugePageVector<size_t> &offsets)
+{
+    vector<int> ids(offsets.size()-1);
+    for (int i=0;i<ids.size();i++)
+    {
+        ids[i] = i;
+    }
+    parallel_sort_ids(ids,[&](int a,int b){
+        size_t len_a = offsets[a+1]-offsets[a];
+        size_t len_b = offsets[b+1]-offsets[b];
+        int ret = memcmp(arena.data()+offsets[a],arena.data()+offsets[b],min(len_a,len_b));
+        return ret != 0? ret < 0 : len_a < len_b;
+    });
+    vector<int> ranks(ids.size());
+    for (int i=0;i<ids.size();i++)
+    {
+        ranks[ids[i]] = i;
+    }
+    return ranks;
+}
+
+// 按照（源端，目标端）字符串的顺序排列的规则编号，与MapRuleCounter的输出顺序相同
+vector<int> FingerprintRuleCounter::sorted_rule_ids()
+{
+    vector<int> src_ranks = sort_ids(src_arena,src_offsets);
+    vector<int> tgt_ranks = sort_ids(tgt_arena,tgt_offsets);
+    vector<unsigned long long> keys(rule_stats.size());
+    for (int i=0;i<keys.size();i++)
+    {
+        keys[i] = (unsigned long long)src_ranks[rule_src_ids[i]]*tgt_ranks.size()+tgt_ranks[rule_tgt_ids[i]];
+    }
+    return radix_sort_ids(keys);
+}
+
+void FingerprintRuleCounter::dump_rules()
+{
+    vector<int> rule_ids = sorted_rule_ids();
+    write_rule_table(rule_ids.size(),[&](size_t i,ostream &out){
+        int rule_idx = rule_ids[i];
+        int src_id = rule_src_ids[rule_idx];
+        int tgt_id = rule_tgt_ids[rule_idx];
+        double rule_count = rule_stats[rule_idx].count;
+        double lex_weight_t2s = rule_stats[rule_idx].acc_lex_weight_t2s/rule_count;
+        double lex_weight_s2t = rule_stats[rule_idx].acc_lex_weight_s2t/rule_count;
+        double trans_prob_t2s = rule_count/src_counts[src_id];
+        double trans_prob_s2t = rule_count/tgt_counts[tgt_id];
+        double root2rule_prob = rule_count/root_counts[src_root_ids[src_id]];
+        out.write(src_arena.data()+src_offsets[src_id],src_offsets[src_id+1]-src_offsets[src_id]);
+        out<<" ||| ";
+        out.write(tgt_arena.data()+tgt_offsets[tgt_id],tgt_offsets[tgt_id+1]-tgt_offsets[tgt_id]);
+        out<<" ||| "<<root2rule_prob<<" "<<trans_prob_t2s<<" "<<trans_prob_s2t<<" "<<lex_weight_t2s<<" "<<lex_weight_s2t<<"\n";
+    },cout);
+}
+
+void FingerprintRuleCounter::collect_rules(vector<ScoredRule> &scored_rules)
+{
+    scored_rules.clear();
+    vector<int> rule_ids = sorted_rule_ids();
+    for (int rule_idx : rule_ids)
+    {
+        int src_id = rule_src_ids[rule_idx];
+        int tgt_id = rule_tgt_ids[rule_idx];
+        double rule_count = rule_stats[rule_idx].count;
+        scored_rules.push_back({string(src_arena.data()+src_offsets[src_id],src_offsets[src_id+1]-src_offsets[src_id]),string(tgt_arena.data()+tgt_offsets[tgt_id],tgt_offsets[tgt_id+1]-tgt_offsets[tgt_id]),rule_count,rule_count/root_counts[src_root_ids[src_id]],rule_count/src_counts[src_id],
+                                rule_count/tgt_counts[tgt_id],rule_stats[rule_idx].acc_lex_weight_t2s/rule_count,rule_stats[rule_idx].acc_lex_weight_s2t/rule_count});
+    }
+}
+
+void FingerprintRuleCounter::write_counts(ostream &out)
+{
+    out.precision(17);
+    vector<int> rule_ids = sorted_rule_ids();
+    for (int rule_idx : rule_ids)
+    {
+        int src_id = rule_src_ids[rule_idx];
+        int tgt_id = rule_tgt_ids[rule_idx];
+        out.write(src_arena.data()+src_offsets[src_id],src_offsets[src_id+1]-src_offsets[src_id]);
+        out<<" ||| ";
+        out.write(tgt_arena.data()+tgt_offsets[tgt_id],tgt_offsets[tgt_id+1]-tgt_offsets[tgt_id]);
+        out<<" ||| "<<rule_stats[rule_idx].count<<" "<<rule_stats[rule_idx].acc_lex_weight_t2s<<" "<<rule_stats[rule_idx].acc_lex_weight_s2t<<"\n";
+    }
+}
+
+size_t FingerprintRuleCounter::memory_size()
+{
+    size_t bytes = src_table.memory_size()+tgt_table.memory_size()+rule_table.memory_size();
+    bytes += src_arena.capacity()+tgt_arena.capacity()+(src_offsets.capacity()+tgt_offsets.capacity())*sizeof(size_t);
+    bytes += (src_root_ids.capacity()+rule_src_ids.capacity()+rule_tgt_ids.capacity())*sizeof(int);
+    bytes += (src_counts.capacity()+tgt_counts.capacity()+root_counts.capacity())*sizeof(double);
+    bytes += rule_stats.capacity()*sizeof(CountAndLexWeight);
+    for (auto &kvp : root2id)
+    {
+        bytes += kvp.first.capacity()+sizeof(kvp)+sizeof(void*)*2;
+    }
+    return bytes;
+}
@@ -0,0 +1,45 @@
+#ifndef FINGERPRINT_RULE_COUNTER_H
+#define FINGERPRINT_RULE_COUNTER_H
+#include "stdafx.h"
+#include "huge_page_allocator.h"
+#include "rule_counter.h"
+#include "fingerprint_table.h"
+
+// 规则、源端、目标端都以128位指纹为键，源端和目标端的字符串只在加入时写入一次只追加的字符串区
+class FingerprintRuleCounter : public RuleCounter
+{
+    public:
+        FingerprintRuleCounter();
+        void update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat);
+        void merge(RuleCounter &other);
+        void dump_rules();
+        void collect_rules(vector<ScoredRule> &scored_rules);
+        void write_counts(ostream &out);
+        size_t memory_size();
+
+    private:
+        vector<int> sorted_rule_ids();
+        int find_or_add_src(const Fingerprint &fp,const char *text,size_t len);
+        int find_or_add_tgt(const Fingerprint &fp,const char *text,size_t len);
+        int find_or_add_rule(const Fingerprint &fp,int src_id,int tgt_id);
+        vector<int> sort_ids(const HugePageVector<char> &arena,const HugePageVector<size_t> &offsets);
+
+    private:
+        FingerprintTable src_table;
+        FingerprintTable tgt_table;
+        FingerprintTable rule_table;
+        HugePageVector<char> src_arena;                             // 所有源端字符串首尾相接存放
+        HugePageVector<size_t> src_offsets;                         // 第i个源端为src_arena[src_offsets[i],src_offsets[i+1])
+        HugePageVector<char> tgt_arena;
+        HugePageVector<size_t> tgt_offsets;
+        unordered_map<string,int> root2id;
+        HugePageVector<int> src_root_ids;                           // 每个源端的根节点标签id
+        HugePageVector<double> src_counts;
+        HugePageVector<double> tgt_counts;
+        HugePageVector<double> root_counts;
+        HugePageVector<int> rule_src_ids;
+        HugePageVector<int> rule_tgt_ids;
+        HugePageVector<CountAndLexWeight> rule_stats;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "fingerprint_table.h"
+
+FingerprintTable::FingerprintTable()
+{
+	slots.resize(16);
+	for (auto &slot : slots)
+	{
+		slot.id = -1;
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 查找指纹对应的id，不存在时为其分配新的id
+ 2. 入口参数: 指纹
+ 3. 出口参数: id，是否为新加入的指纹
+ 4. 算法简介: 线性探测，每次探测只比较槽中的16字节指纹；装载因子超过0.7时扩容
+************************************************************************************* */
+int FingerprintTable::find_or_add(const Fingerprint &fp,bool &is_new)
+{
+	size_t mask = slots.size()-1;
+	size_t pos = fp.lo&mask;
+	while (slots[pos].id != -1)
+	{
+		if (slots[pos].fp == fp)
+		{
+			is_new = false;
+			return slots[pos].id;
+		}
+		pos = (pos+1)&mask;
+	}
+	is_new = true;
+	int id = fps.size();
+	slots[pos].fp = fp;
+	slots[pos].id = id;
+	fps.push_back(fp);
+	if (fps.size()*10 > slots.size()*7)
+	{
+		rehash();
+	}
+	return id;
+}
+
+void FingerprintTable::rehash()
+{
+	slots.resize(slots.size()*2);
+	for (auto &slot : slots)
+	{
+		slot.id = -1;
+	}
+	size_t mask = slots.size()-1;
+	for (int id=0;id<fps.size();id++)
+	{
+		size_t pos = fps[id].lo&mask;
+		while (slots[pos].id != -1)
+		{
+			pos = (pos+1)&mask;
+		}
+		slots[pos].fp = fps[id];
+		slots[pos].id = id;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef FINGERPRINT_TABLE_H
+#define FINGERPRINT_TABLE_H
+#include "stdafx.h"
+#include "huge_page_allocator.h"
+#include "myutils.h"
+
+// 以128位指纹为键的开放寻址哈希表，为每个不同的指纹分配从0开始的连续id
+class FingerprintTable
+{
+	public:
+		FingerprintTable();
+		int find_or_add(const Fingerprint &fp,bool &is_new);
+		int size() const
+		{
+			return fps.size();
+		}
+		const Fingerprint& get(int id) const
+		{
+			return fps[id];
+		}
+		size_t memory_size() const
+		{
+			return slots.capacity()*sizeof(Slot)+fps.capacity()*sizeof(Fingerprint);
+		}
+
+	private:
+		struct Slot
+		{
+			Fingerprint fp;
+			int id;																// -1表示空
+		};
+		void rehash();
+
+	private:
+		HugePageVector<Slot> slots;
+		HugePageVector<Fingerprint> fps;										// 第i个指纹，扩容时用
+};
+
+#endif
@@ -0,0 +1,77 @@
+#include "huge_page_allocator.h"
+#include <sys/mman.h>
+
+static HugePageMode huge_page_mode = HUGE_PAGE_OFF;
+
+// 只能在分配任何大数组之前设置
+void set_huge_page_mode(HugePageMode mode)
+{
+	huge_page_mode = mode;
+}
+
+HugePageMode parse_huge_page_mode(const string &mode_name)
+{
+	if (mode_name == "off")
+		return HUGE_PAGE_OFF;
+	if (mode_name == "transparent")
+		return HUGE_PAGE_TRANSPARENT;
+	if (mode_name == "explicit")
+		return HUGE_PAGE_EXPLICIT;
+	cerr<<"unknown huge page mode: "<<mode_name<<endl;
+	exit(1);
+}
+
+static size_t round_to_huge_page(size_t bytes)
+{
+	return (bytes+HUGE_PAGE_MIN_BYTES-1)/HUGE_PAGE_MIN_BYTES*HUGE_PAGE_MIN_BYTES;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 分配一块内存
+ 2. 入口参数: 字节数
+ 3. 出口参数: 内存地址
+ 4. 算法简介: 小块内存用malloc；大块内存总是用mmap按大页大小取整分配，这样释放时
+ 			  只需根据字节数即可判断分配方式；显式大页没有预留时退回普通页加madvise，
+			  madvise失败时仍使用普通页
+************************************************************************************* */
+void* allocate_pages(size_t bytes)
+{
+	if (bytes < HUGE_PAGE_MIN_BYTES)
+	{
+		void *p = malloc(bytes);
+		if (p == NULL && bytes > 0)
+			throw bad_alloc();
+		return p;
+	}
+	size_t mapped_bytes = round_to_huge_page(bytes);
+	void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	if (huge_page_mode == HUGE_PAGE_EXPLICIT)
+	{
+		p = mmap(NULL,mapped_bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB,-1,0);
+	}
+#endif
+	if (p == MAP_FAILED)
+	{
+		p = mmap(NULL,mapped_bytes,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+		if (p == MAP_FAILED)
+			throw bad_alloc();
+#ifdef MADV_HUGEPAGE
+		if (huge_page_mode != HUGE_PAGE_OFF)
+		{
+			madvise(p,mapped_bytes,MADV_HUGEPAGE);
+		}
+#endif
+	}
+	return p;
+}
+
+void deallocate_pages(void *p,size_t bytes)
+{
+	if (bytes < HUGE_PAGE_MIN_BYTES)
+	{
+		free(p);
+		return;
+	}
+	munmap(p,round_to_huge_page(bytes));
+}
@@ -0,0 +1,45 @@
+#ifndef HUGE_PAGE_ALLOCATOR_H
+#define HUGE_PAGE_ALLOCATOR_H
+#include "stdafx.h"
+
+// 大块内存的分配方式：普通页，透明大页(madvise)，显式大页(MAP_HUGETLB，失败时退回透明大页)
+enum HugePageMode {HUGE_PAGE_OFF,HUGE_PAGE_TRANSPARENT,HUGE_PAGE_EXPLICIT};
+
+void set_huge_page_mode(HugePageMode mode);
+HugePageMode parse_huge_page_mode(const string &mode_name);
+void* allocate_pages(size_t bytes);
+void deallocate_pages(void *p,size_t bytes);
+
+// 计数表和字符串区等大数组使用的分配器，不小于HUGE_PAGE_MIN_BYTES的分配直接向操作系统申请
+template <class T>
+struct HugePageAllocator
+{
+	typedef T value_type;
+	HugePageAllocator() {}
+	template <class U> HugePageAllocator(const HugePageAllocator<U> &other) {}
+	T* allocate(size_t n)
+	{
+		return (T*)allocate_pages(n*sizeof(T));
+	}
+	void deallocate(T *p,size_t n)
+	{
+		deallocate_pages(p,n*sizeof(T));
+	}
+};
+
+template <class T,class U>
+bool operator==(const HugePageAllocator<T> &a,const HugePageAllocator<U> &b)
+{
+	return true;
+}
+
+template <class T,class U>
+bool operator!=(const HugePageAllocator<T> &a,const HugePageAllocator<U> &b)
+{
+	return false;
+}
+
+template <class T>
+using HugePageVector = vector<T,HugePageAllocator<T> >;
+
+#endif
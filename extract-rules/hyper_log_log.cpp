@@ -0,0 +1,43 @@
+#include "hyper_log_log.h"
+
+HyperLogLog::HyperLogLog(int precision)
+{
+	this->precision = precision;
+	registers.assign(1<<precision,0);
+}
+
+void HyperLogLog::add(unsigned long long hash)
+{
+	int idx = hash>>(64-precision);
+	unsigned long long rest = hash<<precision;
+	unsigned char rank = rest == 0? 64-precision+1 : __builtin_clzll(rest)+1;
+	registers[idx] = max(registers[idx],rank);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 估计加入过的不同元素的个数
+ 2. 入口参数: 无
+ 3. 出口参数: 估计值
+ 4. 算法简介: 各寄存器的调和平均乘以修正系数；估计值较小且有空寄存器时改用线性计数
+************************************************************************************* */
+double HyperLogLog::estimate()
+{
+	double m = registers.size();
+	double sum = 0;
+	int zero_num = 0;
+	for (unsigned char reg : registers)
+	{
+		sum += ldexp(1.0,-reg);
+		if (reg == 0)
+		{
+			zero_num++;
+		}
+	}
+	double alpha = 0.7213/(1+1.079/m);
+	double e = alpha*m*m/sum;
+	if (e <= 2.5*m && zero_num > 0)
+	{
+		e = m*log(m/zero_num);
+	}
+	return e;
+}
@@ -0,0 +1,18 @@
+#ifndef HYPER_LOG_LOG_H
+#define HYPER_LOG_LOG_H
+#include "stdafx.h"
+
+// 用固定大小的寄存器估计不同元素的个数，相对误差约为1.04/sqrt(寄存器数)
+class HyperLogLog
+{
+	public:
+		HyperLogLog(int precision=HLL_PRECISION);
+		void add(unsigned long long hash);								// hash应当是均匀分布的64位哈希值
+		double estimate();
+
+	private:
+		int precision;
+		vector<unsigned char> registers;								// 落入每个寄存器的哈希值中，剩余位前导零个数加1的最大值
+};
+
+#endif
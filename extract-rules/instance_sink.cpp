@@ -0,0 +1,150 @@
+#include "instance_sink.h"
+
+InstanceSink::InstanceSink(const string &file_name,InstanceFormat format,int thread_num)
+{
+	fout = fopen(file_name.c_str(),"wb");
+	if (fout == NULL)
+	{
+		cerr<<"cannot open instance file "<<file_name<<endl;
+		exit(1);
+	}
+	this->file_name = file_name;
+	this->format = format;
+	buffers.resize(thread_num);
+	omp_init_lock(&lock);
+	instance_num = 0;
+}
+
+InstanceSink::~InstanceSink()
+{
+	close();
+	omp_destroy_lock(&lock);
+}
+
+static void append_binary(string &buffer,const void *data,size_t len)
+{
+	buffer.append((const char*)data,len);
+}
+
+// 将一个句子的规则实例写入工作线程的缓冲区，多个线程可以同时调用
+void InstanceSink::write(int worker_id,long long sentence_id,double multiplicity,vector<RuleRecord> &rule_records)
+{
+	string &buffer = buffers.at(worker_id);
+	char nums[128];
+	for (auto &record : rule_records)
+	{
+		double count = record.count*multiplicity;
+		if (format == INSTANCE_TEXT)
+		{
+			buffer += to_string(sentence_id)+" ||| "+to_string(record.type)+" ||| "+record.rule_src+" ||| "+record.rule_tgt+" ||| ";
+			snprintf(nums,sizeof(nums),"%g %g %g\n",record.lex_weight_t2s,record.lex_weight_s2t,count);
+			buffer += nums;
+		}
+		else
+		{
+			int type = record.type;
+			unsigned int src_len = record.rule_src.size();
+			unsigned int tgt_len = record.rule_tgt.size();
+			append_binary(buffer,&sentence_id,sizeof(sentence_id));
+			append_binary(buffer,&type,sizeof(type));
+			append_binary(buffer,&count,sizeof(count));
+			append_binary(buffer,&record.lex_weight_t2s,sizeof(double));
+			append_binary(buffer,&record.lex_weight_s2t,sizeof(double));
+			append_binary(buffer,&src_len,sizeof(src_len));
+			buffer += record.rule_src;
+			append_binary(buffer,&tgt_len,sizeof(tgt_len));
+			buffer += record.rule_tgt;
+		}
+	}
+#pragma omp atomic
+	instance_num += rule_records.size();
+	if (buffer.size() >= INSTANCE_BUFFER_BYTES)
+	{
+		flush(worker_id);
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将工作线程的缓冲区追加到文件中
+ 2. 入口参数: 工作线程编号
+ 3. 出口参数: 无
+ 4. 算法简介: 文本格式先在当前线程中压缩为一个独立的gzip成员，只有写文件时加锁，
+ 			  因此压缩可以在各线程中并行；压缩或写文件失败时退出，不留下不完整的实例
+************************************************************************************* */
+void InstanceSink::flush(int worker_id)
+{
+	string &buffer = buffers.at(worker_id);
+	if (buffer.empty())
+		return;
+	string compressed;
+	if (format == INSTANCE_TEXT)
+	{
+		z_stream stream;
+		memset(&stream,0,sizeof(stream));
+		if (deflateInit2(&stream,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY) != Z_OK)	// 15+16表示gzip格式
+		{
+			cerr<<"cannot compress instance file "<<file_name<<endl;
+			exit(1);
+		}
+		compressed.resize(deflateBound(&stream,buffer.size()));
+		stream.next_in = (Bytef*)buffer.data();
+		stream.avail_in = buffer.size();
+		stream.next_out = (Bytef*)&compressed[0];
+		stream.avail_out = compressed.size();
+		if (deflate(&stream,Z_FINISH) != Z_STREAM_END)						// 输出空间为deflateBound，一次调用应当压缩完
+		{
+			cerr<<"cannot compress instance file "<<file_name<<endl;
+			exit(1);
+		}
+		compressed.resize(stream.total_out);
+		deflateEnd(&stream);
+		buffer.swap(compressed);
+	}
+	omp_set_lock(&lock);
+	bool written = fwrite(buffer.data(),1,buffer.size(),fout) == buffer.size();
+	omp_unset_lock(&lock);
+	if (!written)
+	{
+		cerr<<"cannot write instance file "<<file_name<<endl;
+		exit(1);
+	}
+	buffer.clear();
+}
+
+// 输出所有缓冲区中剩余的实例并关闭文件
+void InstanceSink::close()
+{
+	if (fout == NULL)
+		return;
+	for (int i=0;i<buffers.size();i++)
+	{
+		flush(i);
+	}
+	if (fclose(fout) != 0)
+	{
+		cerr<<"cannot write instance file "<<file_name<<endl;
+		exit(1);
+	}
+	fout = NULL;
+}
+
+// 各工作线程缓冲区占用的内存，缓冲区写出后清空但保留容量，因此按容量计算
+size_t InstanceSink::memory_size()
+{
+	size_t bytes = 0;
+	for (auto &buffer : buffers)
+	{
+		bytes += buffer.capacity();
+	}
+	return bytes;
+}
+
+InstanceFormat parse_instance_format(const string &format_str)
+{
+	if (format_str == "text")
+		return INSTANCE_TEXT;
+	if (format_str == "binary")
+		return INSTANCE_BINARY;
+	cerr<<"unknown instance format: "<<format_str<<endl;
+	exit(1);
+}
@@ -0,0 +1,44 @@
+#ifndef INSTANCE_SINK_H
+#define INSTANCE_SINK_H
+#include "stdafx.h"
+#include "rule_counter.h"
+
+// 规则实例的输出格式
+enum InstanceFormat {INSTANCE_TEXT,INSTANCE_BINARY};
+
+/**************************************************************************************
+ 只抽取模式下输出每个句子抽取到的规则实例，不做计数
+ 文本格式（gzip压缩）每行为"句子编号 ||| 规则类型 ||| 源端 ||| 目标端 ||| t2s词汇权重 s2t词汇权重 次数"；
+ 二进制格式每条实例依次为int64句子编号，int32规则类型，double次数，double t2s词汇权重，
+ double s2t词汇权重，uint32源端长度及源端字符串，uint32目标端长度及目标端字符串
+ 每个工作线程写入自己的缓冲区，缓冲区写满后由该线程压缩，再加锁追加到文件中；
+ 多个gzip成员首尾相接仍是合法的gzip文件
+************************************************************************************* */
+class InstanceSink
+{
+	public:
+		InstanceSink(const string &file_name,InstanceFormat format,int thread_num);
+		~InstanceSink();
+		void write(int worker_id,long long sentence_id,double multiplicity,vector<RuleRecord> &rule_records);
+		void close();
+		size_t memory_size();
+		long long get_instance_num()
+		{
+			return instance_num;
+		}
+
+	private:
+		void flush(int worker_id);
+
+	private:
+		FILE *fout;
+		string file_name;													// 用于出错时的提示
+		InstanceFormat format;
+		vector<string> buffers;												// 每个工作线程的缓冲区
+		omp_lock_t lock;
+		long long instance_num;
+};
+
+InstanceFormat parse_instance_format(const string &format_str);
+
+#endif
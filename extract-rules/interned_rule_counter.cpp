@@ -0,0 +1,215 @@
+#include "interned_rule_counter.h"
+#include "rule_table_writer.h"
+
+static inline size_t hash_id_pair(int src_id,int tgt_id)
+{
+    unsigned long long h = ((unsigned long long)src_id<<32)|(unsigned int)tgt_id;
+    h ^= h>>33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h>>33;
+    return h;
+}
+
+InternedRuleCounter::InternedRuleCounter()
+{
+    rule_slots.assign(16,-1);
+}
+
+void InternedRuleCounter::update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat)
+{
+    int src_id = find_or_add_src(rule_src);
+    int tgt_id = find_or_add_tgt(rule_tgt);
+    int rule_idx = find_or_add_rule(src_id,tgt_id);
+    rule_stats[rule_idx].count += stat.count;
+    rule_stats[rule_idx].acc_lex_weight_t2s += stat.acc_lex_weight_t2s;
+    rule_stats[rule_idx].acc_lex_weight_s2t += stat.acc_lex_weight_s2t;
+    src_counts[src_id] += stat.count;
+    tgt_counts[tgt_id] += stat.count;
+    root_counts[src_root_ids[src_id]] += stat.count;
+}
+
+int InternedRuleCounter::find_or_add_src(const string &rule_src)
+{
+    int src_id = src_pool.intern(rule_src);
+    if (src_id == src_counts.size())                                            // 新的源端
+    {
+        src_counts.push_back(0);
+        int root_id = root_pool.intern(rule_src.substr(0,rule_src.find(" ")));
+        src_root_ids.push_back(root_id);
+        if (root_id == root_counts.size())
+        {
+            root_counts.push_back(0);
+        }
+    }
+    return src_id;
+}
+
+int InternedRuleCounter::find_or_add_tgt(const string &rule_tgt)
+{
+    int tgt_id = tgt_pool.intern(rule_tgt);
+    if (tgt_id == tgt_counts.size())
+    {
+        tgt_counts.push_back(0);
+    }
+    return tgt_id;
+}
+
+int InternedRuleCounter::find_or_add_rule(int src_id,int tgt_id)
+{
+    size_t mask = rule_slots.size()-1;
+    size_t pos = hash_id_pair(src_id,tgt_id)&mask;
+    while (rule_slots[pos] != -1)
+    {
+        int rule_idx = rule_slots[pos];
+        if (rule_src_ids[rule_idx] == src_id && rule_tgt_ids[rule_idx] == tgt_id)
+            return rule_idx;
+        pos = (pos+1)&mask;
+    }
+    int rule_idx = rule_stats.size();
+    rule_slots[pos] = rule_idx;
+    rule_src_ids.push_back(src_id);
+    rule_tgt_ids.push_back(tgt_id);
+    rule_stats.push_back({0,0,0});
+    if (2*rule_stats.size() > rule_slots.size())
+    {
+        rehash_rules();
+    }
+    return rule_idx;
+}
+
+void InternedRuleCounter::rehash_rules()
+{
+    rule_slots.assign(rule_slots.size()*2,-1);
+    size_t mask = rule_slots.size()-1;
+    for (int rule_idx=0;rule_idx<rule_stats.size();rule_idx++)
+    {
+        size_t pos = hash_id_pair(rule_src_ids[rule_idx],rule_tgt_ids[rule_idx])&mask;
+        while (rule_slots[pos] != -1)
+        {
+            pos = (pos+1)&mask;
+        }
+        rule_slots[pos] = rule_idx;
+    }
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将另一个计数器的统计结果累加到当前计数器中
+ 2. 入口参数: 另一个计数器
+ 3. 出口参数: 无
+ 4. 算法简介: 先把对方的源端和目标端id映射为当前计数器的id，再逐条累加规则
+************************************************************************************* */
+void InternedRuleCounter::merge(RuleCounter &other_counter)
+{
+    InternedRuleCounter &other = dynamic_cast<InternedRuleCounter&>(other_counter);
+    vector<int> src_id_map(other.src_pool.size());
+    for (int i=0;i<other.src_pool.size();i++)
+    {
+        src_id_map[i] = find_or_add_src(other.src_pool.get(i));
+        src_counts[src_id_map[i]] += other.src_counts[i];
+    }
+    vector<int> tgt_id_map(other.tgt_pool.size());
+    for (int i=0;i<other.tgt_pool.size();i++)
+    {
+        tgt_id_map[i] = find_or_add_tgt(other.tgt_pool.get(i));
+        tgt_counts[tgt_id_map[i]] += other.tgt_counts[i];
+    }
+    for (int i=0;i<other.root_pool.size();i++)
+    {
+        root_counts[root_pool.intern(other.root_pool.get(i))] += other.root_counts[i];
+    }
+    for (int i=0;i<other.rule_stats.size();i++)
+    {
+        int rule_idx = find_or_add_rule(src_id_map[other.rule_src_ids[i]],tgt_id_map[other.rule_tgt_ids[i]]);
+        rule_stats[rule_idx].count += other.rule_stats[i].count;
+        rule_stats[rule_idx].acc_lex_weight_t2s += other.rule_stats[i].acc_lex_weight_t2s;
+        rule_stats[rule_idx].acc_lex_weight_s2t += other.rule_stats[i].acc_lex_weight_s2t;
+    }
+}
+
+// 返回每个id按字符串排序后的名次
+vector<int> InternedRuleCounter::sort_ids(const StringInterner &pool)
+{
+    vector<int> ids(pool.size());
+    for (int i=0;i<ids.size();i++)
+    {
+        ids[i] = i;
+    }
+    parallel_sort_ids(ids,[&](int a,int b){return pool.compare(a,b) < 0;});
+    vector<int> ranks(ids.size());
+    for (int i=0;i<ids.size();i++)
+    {
+        ranks[ids[i]] = i;
+    }
+    return ranks;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 输出所有规则及其概率
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 按（源端，目标端）排序输出，由于源端以空格结尾且内部没有连续空格，
+ 			  该顺序与MapRuleCounter按完整规则字符串排序的顺序相同
+************************************************************************************* */
+// 按照（源端，目标端）字符串的顺序排列的规则编号，与MapRuleCounter的输出顺序相同；
+// 源端和目标端的名次组合成一个整数键，规则只需做基数排序，不再比较字符串
+vector<int> InternedRuleCounter::sorted_rule_ids()
+{
+    vector<int> src_ranks = sort_ids(src_pool);
+    vector<int> tgt_ranks = sort_ids(tgt_pool);
+    vector<unsigned long long> keys(rule_stats.size());
+    for (int i=0;i<keys.size();i++)
+    {
+        keys[i] = (unsigned long long)src_ranks[rule_src_ids[i]]*tgt_ranks.size()+tgt_ranks[rule_tgt_ids[i]];
+    }
+    return radix_sort_ids(keys);
+}
+
+void InternedRuleCounter::dump_rules()
+{
+    vector<int> rule_ids = sorted_rule_ids();
+    write_rule_table(rule_ids.size(),[&](size_t i,ostream &out){
+        int rule_idx = rule_ids[i];
+        int src_id = rule_src_ids[rule_idx];
+        int tgt_id = rule_tgt_ids[rule_idx];
+        double rule_count = rule_stats[rule_idx].count;
+        double lex_weight_t2s = rule_stats[rule_idx].acc_lex_weight_t2s/rule_count;
+        double lex_weight_s2t = rule_stats[rule_idx].acc_lex_weight_s2t/rule_count;
+        double trans_prob_t2s = rule_count/src_counts[src_id];
+        double trans_prob_s2t = rule_count/tgt_counts[tgt_id];
+        double root2rule_prob = rule_count/root_counts[src_root_ids[src_id]];
+        out<<src_pool.get(src_id)<<" ||| "<<tgt_pool.get(tgt_id)<<" ||| "<<root2rule_prob<<" "<<trans_prob_t2s<<" "<<trans_prob_s2t<<" "<<lex_weight_t2s<<" "<<lex_weight_s2t<<"\n";
+    },cout);
+}
+
+void InternedRuleCounter::collect_rules(vector<ScoredRule> &scored_rules)
+{
+    scored_rules.clear();
+    vector<int> rule_ids = sorted_rule_ids();
+    for (int rule_idx : rule_ids)
+    {
+        int src_id = rule_src_ids[rule_idx];
+        int tgt_id = rule_tgt_ids[rule_idx];
+        double rule_count = rule_stats[rule_idx].count;
+        scored_rules.push_back({src_pool.get(src_id),tgt_pool.get(tgt_id),rule_count,rule_count/root_counts[src_root_ids[src_id]],rule_count/src_counts[src_id],
+                                rule_count/tgt_counts[tgt_id],rule_stats[rule_idx].acc_lex_weight_t2s/rule_count,rule_stats[rule_idx].acc_lex_weight_s2t/rule_count});
+    }
+}
+
+void InternedRuleCounter::write_counts(ostream &out)
+{
+    out.precision(17);
+    vector<int> rule_ids = sorted_rule_ids();
+    for (int rule_idx : rule_ids)
+    {
+        out<<src_pool.get(rule_src_ids[rule_idx])<<" ||| "<<tgt_pool.get(rule_tgt_ids[rule_idx])<<" ||| "<<rule_stats[rule_idx].count<<" "
+           <<rule_stats[rule_idx].acc_lex_weight_t2s<<" "<<rule_stats[rule_idx].acc_lex_weight_s2t<<"\n";
+    }
+}
+
+size_t InternedRuleCounter::memory_size()
+{
+    return src_pool.memory_size()+tgt_pool.memory_size()+root_pool.memory_size()
+           +(src_root_ids.capacity()+rule_src_ids.capacity()+rule_tgt_ids.capacity()+rule_slots.capacity())*sizeof(int)
+           +(src_counts.capacity()+tgt_counts.capacity()+root_counts.capacity())*sizeof(double)
+           +rule_stats.capacity()*sizeof(CountAndLexWeight);
+}
@@ -0,0 +1,42 @@
+#ifndef INTERNED_RULE_COUNTER_H
+#define INTERNED_RULE_COUNTER_H
+#include "stdafx.h"
+#include "huge_page_allocator.h"
+#include "rule_counter.h"
+#include "string_interner.h"
+
+// 源端和目标端字符串各自只存放一次，规则表示为（源端id，目标端id），计数存放在连续数组中
+class InternedRuleCounter : public RuleCounter
+{
+    public:
+        InternedRuleCounter();
+        void update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat);
+        void merge(RuleCounter &other);
+        void dump_rules();
+        void collect_rules(vector<ScoredRule> &scored_rules);
+        void write_counts(ostream &out);
+        size_t memory_size();
+
+    private:
+        vector<int> sorted_rule_ids();
+        int find_or_add_src(const string &rule_src);
+        int find_or_add_tgt(const string &rule_tgt);
+        int find_or_add_rule(int src_id,int tgt_id);
+        void rehash_rules();
+        vector<int> sort_ids(const StringInterner &pool);
+
+    private:
+        StringInterner src_pool;
+        StringInterner tgt_pool;
+        StringInterner root_pool;
+        HugePageVector<int> src_root_ids;                           // 每个源端的根节点标签id
+        HugePageVector<double> src_counts;
+        HugePageVector<double> tgt_counts;
+        HugePageVector<double> root_counts;
+        HugePageVector<int> rule_src_ids;                           // 第i条规则的源端id
+        HugePageVector<int> rule_tgt_ids;                           // 第i条规则的目标端id
+        HugePageVector<CountAndLexWeight> rule_stats;               // 第i条规则的次数及累加的词汇权重
+        HugePageVector<int> rule_slots;                             // 以（源端id，目标端id）为键的开放寻址哈希表，存放规则编号
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "lex_table.h"
+
+/**************************************************************************************
+ 1. 函数功能: 从文件加载两个方向的词汇翻译表
+ 2. 入口参数: 两个词汇翻译表文件，每行为"词 词 概率"
+ 3. 出口参数: 无
+ 4. 算法简介: 无
+************************************************************************************* */
+void LexTable::load(const string &lex_s2t_file,const string &lex_t2s_file)
+{
+	vector<string> files = {lex_s2t_file,lex_t2s_file};
+	vector<map<string,double>*> tables = {&lex_s2t,&lex_t2s};
+	for (int i=0;i<2;i++)
+	{
+		ifstream fin(files.at(i).c_str());
+		string line;
+		while(getline(fin,line))
+		{
+			vector<string> vs = Split(line);
+			add(*tables.at(i),vs[0],vs[1],stod(vs[2]));
+		}
+	}
+}
+
+// 向词汇翻译表中加入一个词对，只能在开始抽取之前调用
+void LexTable::add(map<string,double> &lex_trans_table,const string &word1,const string &word2,double prob)
+{
+	lex_trans_table[word1+" "+word2] = prob;
+}
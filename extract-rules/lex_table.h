@@ -0,0 +1,16 @@
+#ifndef LEX_TABLE_H
+#define LEX_TABLE_H
+#include "stdafx.h"
+#include "myutils.h"
+
+// 两个方向的词汇翻译表，以"词 词"为键；加载完成后只读，可以被多个线程和多个抽取器同时查询
+struct LexTable
+{
+	map<string,double> lex_s2t;
+	map<string,double> lex_t2s;
+
+	void load(const string &lex_s2t_file,const string &lex_t2s_file);
+	void add(map<string,double> &lex_trans_table,const string &word1,const string &word2,double prob);
+};
+
+#endif
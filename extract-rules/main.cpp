@@ -2,36 +2,532 @@
 #include "myutils.h"
 #include "rule_extractor.h"
 #include "rule_counter.h"
+#include "sentence_scheduler.h"
+#include "sentence_cache.h"
+#include "lex_table.h"
+#include "numa_topology.h"
+#include "huge_page_allocator.h"
+#include "memory_budget.h"
+#include "count_spiller.h"
+#include "instance_sink.h"
+#include "extraction_server.h"
+#include "rule_table_estimator.h"
+#include "rule_table_writer.h"
+#include "compiled_corpus.h"
 
-void load_lex_trans_table(map<string,double> &lex_trans_table,string lex_trans_file)
+// 解析命令行参数，形如--name=value的参数放入options，其余参数按顺序放入args
+void parse_args(int argc,char* argv[],vector<string> &args,map<string,string> &options)
 {
-	ifstream fin(lex_trans_file.c_str());
-    string line;
-    while(getline(fin,line))
-    {
-        vector<string> vs = Split(line);
-        lex_trans_table[vs[0]+" "+vs[1]] = stod(vs[2]);
-    }
-};
+	for (int i=1;i<argc;i++)
+	{
+		string arg = argv[i];
+		if (arg.substr(0,2) == "--")
+		{
+			size_t pos = arg.find("=");
+			if (pos == string::npos)
+			{
+				options[arg.substr(2)] = "";
+			}
+			else
+			{
+				options[arg.substr(2,pos-2)] = arg.substr(pos+1);
+			}
+		}
+		else
+		{
+			args.push_back(arg);
+		}
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 读入一个句子的k-best句法树
+ 2. 入口参数: 句法树文件，权重是否为对数概率
+ 3. 出口参数: 各句法树的字符串及权重，文件已读完时返回false
+ 4. 算法简介: 每棵句法树占一行，以空行结束；每行可以写成"权重 ||| 句法树"的形式，
+ 			  每行由parse_kbest_line解析，权重不合法时退出。之后由select_kbest_trees
+			  去掉不能使用的句法树并归一化权重；各句法树的叶子节点序列不同时跳过该句子，
+			  不返回任何句法树
+************************************************************************************* */
+bool read_kbest_trees(ifstream &ft,bool log_weights,vector<string> &lines_tree,vector<double> &tree_weights)
+{
+	lines_tree.clear();
+	tree_weights.clear();
+	string line;
+	bool has_line = false;
+	while(getline(ft,line))
+	{
+		has_line = true;
+		TrimLine(line);
+		if (line.empty())
+			break;
+		string line_tree;
+		double weight;
+		string error;
+		if (!TreeStrPair::parse_kbest_line(line,log_weights,line_tree,weight,error))
+		{
+			cerr<<error<<endl;
+			exit(1);
+		}
+		lines_tree.push_back(line_tree);
+		tree_weights.push_back(weight);
+	}
+	string error;
+	if (!TreeStrPair::select_kbest_trees(lines_tree,tree_weights,log_weights,error))
+	{
+		cerr<<error<<", skip sentence\n";
+	}
+	return has_line;
+}
+
+// 从命令行参数中取出抽取规则的设置，命令行抽取和服务模式共用
+ExtractionOptions parse_extraction_options(map<string,string> &options)
+{
+	ExtractionOptions extraction_options;
+	if (options.count("max-rule-size"))										//组合规则最多由几个最小规则组成
+	{
+		extraction_options.max_rule_size = stoi(options["max-rule-size"]);
+	}
+	if (options.count("max-lhs-node-num"))									//规则左端最多有几个节点
+	{
+		extraction_options.max_lhs_node_num = stoi(options["max-lhs-node-num"]);
+	}
+	extraction_options.dp_compose = options.count("compose") && options["compose"] == "dp";	//组合规则的生成方式，rounds（逐轮扩展）或dp（动态规划）
+	extraction_options.kbest_input = options.count("kbest") > 0;			//句法树文件中每个句子有多棵句法树
+	extraction_options.log_tree_weights = extraction_options.kbest_input && options["kbest"] == "logprob";	//--kbest=logprob：句法树的权重是对数概率
+	return extraction_options;
+}
+
+// 将一个句子的所有输入拼接起来，作为检查重复句子的键
+string make_sentence_key(string &line_tree,string &line_str,string &line_align)
+{
+	return line_tree+"\n"+line_str+"\n"+line_align;
+}
+
+string make_sentence_key(vector<string> &lines_tree,vector<double> &tree_weights,string &line_str,string &line_align)
+{
+	string key;
+	for (int i=0;i<lines_tree.size();i++)
+	{
+		key += to_string(tree_weights.at(i))+" ||| "+lines_tree.at(i)+"\n";
+	}
+	return key+line_str+"\n"+line_align;
+}
 
 int main(int argc, char* argv[])
 {
-	ifstream ft(argv[1]);
-	ifstream fs(argv[2]);
-	ifstream fa(argv[3]);
-	map<string,double> lex_s2t;
-	map<string,double> lex_t2s;
-    load_lex_trans_table(lex_s2t,argv[4]);
-    load_lex_trans_table(lex_t2s,argv[5]);
-    RuleCounter rule_counter;
+	vector<string> args;
+	map<string,string> options;
+	parse_args(argc,argv,args,options);
+	int thread_num = options.count("threads")? stoi(options["threads"]) : omp_get_max_threads();
+	set_output_thread_num(thread_num);										//最终规则表也用同样多的线程排序和输出
+	ExtractionOptions extraction_options = parse_extraction_options(options);
+	if (options.count("server"))											//服务模式，只需给出两个词汇翻译表；--server为stdin或Unix域套接字的路径
+	{
+		if (extraction_options.kbest_input)
+		{
+			cerr<<"server mode only supports 1-best extraction\n";
+			return 1;
+		}
+		LexTable lex_table;
+		lex_table.load(args.at(0),args.at(1));
+		ExtractionServer server(&lex_table,thread_num,extraction_options,options.count("server-counts") > 0);	//--server-counts：回复中带有规则的累计次数
+		if (options["server"].empty() || options["server"] == "stdin")
+		{
+			server.serve_stdin();
+		}
+		else
+		{
+			server.serve_socket(options["server"]);
+		}
+		cerr<<server.get_sentence_num()<<" sentences served\n";
+		return 0;
+	}
+	if (options.count("compile-corpus"))									//将三个文本输入文件编译成二进制语料后退出
+	{
+		compile_corpus(args.at(0),args.at(1),args.at(2),options["compile-corpus"]);
+		return 0;
+	}
+	CompiledCorpus *corpus = NULL;											//预先编译的二进制语料，代替三个文本输入文件，此时只需给出两个词汇翻译表
+	ifstream ft,fs,fa;
+	if (options.count("corpus"))
+	{
+		corpus = new CompiledCorpus(options["corpus"]);
+	}
+	else
+	{
+		ft.open(args.at(0));
+		fs.open(args.at(1));
+		fa.open(args.at(2));
+	}
+	long long next_corpus_idx = 0;											//--range=BEGIN-END只抽取二进制语料中编号在[BEGIN,END)内的句子
+	long long corpus_end = corpus == NULL? 0 : corpus->size();
+	if (corpus != NULL && options.count("range"))
+	{
+		vector<string> range = Split(options["range"],"-");
+		next_corpus_idx = min(max(stoll(range.at(0)),0LL),corpus_end);
+		if (range.size() > 1 && !range.at(1).empty())
+		{
+			corpus_end = max(min(stoll(range.at(1)),corpus_end),next_corpus_idx);
+		}
+	}
+	LexTable lex_table;
+	int lex_arg = corpus == NULL? 3 : 0;
+	lex_table.load(args.at(lex_arg),args.at(lex_arg+1));
+	string counter_type = options.count("counter")? options["counter"] : "map";	//规则计数器的类型，map、interned或fingerprint
+	if (options.count("huge-pages"))										//计数器中的大数组是否使用大页，off、transparent或explicit
+	{
+		set_huge_page_mode(parse_huge_page_mode(options["huge-pages"]));
+	}
+	bool extract_only = options.count("extract-only") > 0;					//只抽取不计数，将每个规则实例写入该选项给出的文件
+	bool estimate_only = options.count("estimate") > 0;						//只抽样估计规则表大小和运行时间，--estimate=N指定抽样的句子数
+	vector<RuleCounter*> rule_counters;
+	for (int i=0;i<thread_num && !extract_only && !estimate_only;i++)
+	{
+		rule_counters.push_back(create_rule_counter(counter_type));
+	}
+	bool kbest_input = extraction_options.kbest_input;
+	bool log_tree_weights = extraction_options.log_tree_weights;
+	if (corpus != NULL && (kbest_input || estimate_only))
+	{
+		cerr<<"compiled corpus only supports 1-best extraction\n";
+		return 1;
+	}
+	bool dedup = options.count("no-dedup") == 0 && !extract_only;			//重复的句子只抽取一次；只抽取时每个句子的实例都要输出
+	long long max_cache_record_num = options.count("dedup-cache-records")? stoll(options["dedup-cache-records"]) : DEDUP_CACHE_RECORD_NUM;
+	SentenceCache sentence_cache(max_cache_record_num);
+	SentenceScheduler scheduler(thread_num);
+	scheduler.set_batched_counting(options.count("batched-counting") > 0);	//缓存多个句子的规则，按划分预聚合后再写入计数器
+	InstanceSink *instance_sink = NULL;
+	if (extract_only)
+	{
+		InstanceFormat instance_format = parse_instance_format(options.count("instance-format")? options["instance-format"] : "text");	//text（gzip压缩的文本）或binary
+		instance_sink = new InstanceSink(options["extract-only"],instance_format,thread_num);
+		scheduler.set_instance_sink(instance_sink);
+	}
+	NumaTopology numa_topology;
+	if (options.count("numa"))												//将工作线程按NUMA节点绑定，计数器在节点内先合并
+	{
+		if (numa_topology.get_node_num() > 1)
+		{
+			scheduler.set_numa_topology(&numa_topology);
+		}
+		else
+		{
+			cerr<<"only one NUMA node, workers are not pinned\n";
+		}
+	}
+	// 内存上限，如"8G"，不设置时不限制。内存只在每批句子处理完后检查，一批之内不会因超限而停下，
+	// 因此设置上限时第一批只读入MIN_SENTENCE_BATCH_SIZE个句子，之后内存充裕时每批加倍
+	long long max_memory = options.count("max-memory")? parse_memory_size(options["max-memory"]) : 0;
+	MemoryBudget memory_budget(max_memory);
+	scheduler.set_memory_tracking(max_memory > 0);
+	CountSpiller count_spiller(options.count("spill-dir")? options["spill-dir"] : ".");	//计数器溢出文件所在的目录
+	int batch_size = max_memory > 0? MIN_SENTENCE_BATCH_SIZE : SENTENCE_BATCH_SIZE;	//内存紧张时减小每批读入的句子数
+	int rule_size_limit = extraction_options.max_rule_size;					//组合规则最多由几个最小规则组成
+	int expensive_rule_size = rule_size_limit;								//内存紧张时代价大的句子的组合规则大小上限，其余句子不受影响
+	double expensive_cost = 0;												//估计代价不小于该值的句子为代价大的句子
+	int min_used_rule_size = rule_size_limit;								//抽取过程中用过的最小的组合规则大小上限
+	long long reduced_sentence_num = 0;										//用较小的组合规则大小上限抽取的句子数
+	bool budget_warned = false;
+	if (estimate_only)
+	{
+		int sample_size = options["estimate"].empty()? ESTIMATE_SAMPLE_SIZE : stoi(options["estimate"]);
+		RuleTableEstimator estimator(&lex_table,thread_num,counter_type,sample_size,dedup);
+		SampledSentence sentence;
+		while(true)
+		{
+			if (kbest_input)
+			{
+				if (!read_kbest_trees(ft,log_tree_weights,sentence.lines_tree,sentence.tree_weights))
+					break;
+			}
+			else
+			{
+				sentence.lines_tree.resize(1);
+				sentence.tree_weights.assign(1,1.0);
+				if (!getline(ft,sentence.lines_tree.at(0)))
+					break;
+			}
+			getline(fs,sentence.line_str);
+			getline(fa,sentence.line_align);
+			estimator.offer(sentence);
+		}
+		estimator.estimate(rule_size_limit,extraction_options.max_lhs_node_num,extraction_options.dp_compose,kbest_input);
+		estimator.report();
+		return 0;
+	}
+	long long processed_sentence_num = 0;
+	vector<string> lines_tree,lines_str,lines_align;
+	vector<long long> corpus_ids;											//二进制语料输入时当前批中各句子的编号
+	vector<vector<string> > kbest_lines_tree;
+	vector<vector<double> > kbest_tree_weights;
 	string line_tree,line_str,line_align;
-	while(getline(ft,line_tree))
+	vector<string> trees;
+	vector<double> weights;
+	bool finished = false;
+	while(!finished)
+	{
+		lines_tree.clear();
+		lines_str.clear();
+		lines_align.clear();
+		kbest_lines_tree.clear();
+		kbest_tree_weights.clear();
+		corpus_ids.clear();
+		long long input_bytes = 0;
+		while(lines_str.size()+corpus_ids.size() < batch_size)
+		{
+			if (corpus != NULL)
+			{
+				if (next_corpus_idx >= corpus_end)
+				{
+					finished = true;
+					break;
+				}
+				input_bytes += corpus->sentence_bytes(next_corpus_idx);
+				corpus_ids.push_back(next_corpus_idx++);
+				continue;
+			}
+			if (kbest_input)
+			{
+				if (!read_kbest_trees(ft,log_tree_weights,trees,weights))
+				{
+					finished = true;
+					break;
+				}
+				kbest_lines_tree.push_back(trees);
+				kbest_tree_weights.push_back(weights);
+				for (auto &tree : trees)
+				{
+					input_bytes += tree.size();
+				}
+			}
+			else
+			{
+				if (!getline(ft,line_tree))
+				{
+					finished = true;
+					break;
+				}
+				lines_tree.push_back(line_tree);
+				input_bytes += line_tree.size();
+			}
+			getline(fs,line_str);
+			getline(fa,line_align);
+			input_bytes += line_str.size()+line_align.size();
+			lines_str.push_back(line_str);
+			lines_align.push_back(line_align);
+		}
+		int batch_sentence_num = lines_str.size()+corpus_ids.size();
+		vector<int> unique_ids;												//需要抽取的句子在当前批中的位置
+		vector<int> multiplicities;											//每个需要抽取的句子在当前批中出现的次数
+		vector<string> unique_keys;
+		unordered_map<string,int> key2unique_idx;
+		for (int i=0;i<batch_sentence_num;i++)
+		{
+			if (!dedup)
+			{
+				unique_ids.push_back(i);
+				multiplicities.push_back(1);
+				continue;
+			}
+			string key;
+			if (corpus != NULL)
+			{
+				key = corpus->sentence_key(corpus_ids.at(i));
+			}
+			else
+			{
+				key = kbest_input? make_sentence_key(kbest_lines_tree.at(i),kbest_tree_weights.at(i),lines_str.at(i),lines_align.at(i))
+								 : make_sentence_key(lines_tree.at(i),lines_str.at(i),lines_align.at(i));
+			}
+			sentence_cache.sentence_num++;
+			vector<RuleRecord>* cached_records = sentence_cache.find(key);
+			if (cached_records != NULL)										//前面的批中抽取过该句子
+			{
+				sentence_cache.cache_hit_num++;
+				rule_counters.at(0)->update(*cached_records,1);
+				continue;
+			}
+			auto it = key2unique_idx.find(key);
+			if (it != key2unique_idx.end())									//与当前批中前面的句子重复
+			{
+				sentence_cache.batch_hit_num++;
+				multiplicities.at(it->second)++;
+				continue;
+			}
+			key2unique_idx[key] = unique_ids.size();
+			unique_ids.push_back(i);
+			multiplicities.push_back(1);
+			unique_keys.push_back(key);
+		}
+		vector<RuleExtractor*> rule_extractors(unique_ids.size());
+		vector<int> used_rule_sizes(unique_ids.size());						//每个句子抽取时的组合规则大小上限，抽取器在调度时释放，因此另外记录
+		vector<double> batch_costs(max_memory > 0? unique_ids.size() : 0);	//设置内存上限时记录每个句子的估计代价，用于划分代价大的句子
+#pragma omp parallel for schedule(dynamic) num_threads(thread_num)
+		for (int j=0;j<unique_ids.size();j++)
+		{
+			int i = unique_ids.at(j);
+			if (corpus != NULL)
+			{
+				ParsedTree tree;
+				vector<string> tgt_words;
+				vector<pair<int,int> > alignment;
+				corpus->get_sentence(corpus_ids.at(i),tree,tgt_words,alignment);
+				rule_extractors.at(j) = new RuleExtractor(tree,tgt_words,alignment,&lex_table.lex_s2t,&lex_table.lex_t2s);
+			}
+			else if (kbest_input)
+			{
+				rule_extractors.at(j) = new RuleExtractor(kbest_lines_tree.at(i),kbest_tree_weights.at(i),lines_str.at(i),lines_align.at(i),&lex_table.lex_s2t,&lex_table.lex_t2s);
+			}
+			else
+			{
+				rule_extractors.at(j) = new RuleExtractor(lines_tree.at(i),lines_str.at(i),lines_align.at(i),&lex_table.lex_s2t,&lex_table.lex_t2s);
+			}
+			rule_extractors.at(j)->multiplicity = multiplicities.at(j);
+			rule_extractors.at(j)->sentence_id = corpus != NULL? corpus_ids.at(i) : processed_sentence_num+i;
+			rule_extractors.at(j)->set_options(extraction_options);
+			used_rule_sizes.at(j) = rule_size_limit;
+			if (max_memory > 0)
+			{
+				batch_costs.at(j) = rule_extractors.at(j)->estimate_cost();		//按完整的上限估计，代价大的句子不随上限的调整而变化
+				if (expensive_rule_size < rule_size_limit && batch_costs.at(j) >= expensive_cost)
+				{
+					rule_extractors.at(j)->max_rule_size = expensive_rule_size;
+					used_rule_sizes.at(j) = expensive_rule_size;
+				}
+			}
+		}
+		for (int used_rule_size : used_rule_sizes)
+		{
+			reduced_sentence_num += used_rule_size < rule_size_limit;
+			min_used_rule_size = min(min_used_rule_size,used_rule_size);
+		}
+		if (dedup)
+		{
+			vector<vector<RuleRecord> > kept_records(unique_ids.size());
+			scheduler.run(rule_extractors,rule_counters,&kept_records);
+			for (int j=0;j<unique_ids.size();j++)
+			{
+				if (used_rule_sizes.at(j) == rule_size_limit)				//内存紧张时用较小上限抽取的规则不完整，不缓存，否则之后重复的句子也会缺少规则
+				{
+					sentence_cache.insert(unique_keys.at(j),kept_records.at(j));
+				}
+			}
+		}
+		else
+		{
+			scheduler.run(rule_extractors,rule_counters);
+		}
+		if (batch_sentence_num == 0)
+			continue;
+		processed_sentence_num += batch_sentence_num;
+		long long counter_bytes = 0;
+		for (auto counter : rule_counters)
+		{
+			counter_bytes += counter->memory_size();
+		}
+		memory_budget.set(MEM_INPUT,input_bytes);
+		memory_budget.set(MEM_RULES,scheduler.get_peak_live_bytes());
+		memory_budget.set(MEM_COUNTERS,counter_bytes);
+		memory_budget.set(MEM_CACHE,sentence_cache.memory_size());
+		memory_budget.set(MEM_OUTPUT,instance_sink == NULL? 0 : instance_sink->memory_size());	//只抽取时各工作线程尚未写出的实例
+		cerr<<processed_sentence_num<<" sentences, memory: "<<memory_budget.report()<<endl;
+		if (memory_budget.near_limit())
+		{
+			// 先用不损失规则的办法回到上限以下：缩小缓存，将计数器溢出到磁盘，减少每批读入的句子数
+			if (sentence_cache.memory_size() > 0)
+			{
+				sentence_cache.shrink();
+				memory_budget.set(MEM_CACHE,sentence_cache.memory_size());
+			}
+			if (memory_budget.near_limit() && counter_bytes > 0)
+			{
+				scheduler.merge_counters(rule_counters);
+				count_spiller.spill(rule_counters.at(0));
+				delete rule_counters.at(0);
+				rule_counters.clear();
+				for (int i=0;i<thread_num;i++)
+				{
+					rule_counters.push_back(create_rule_counter(counter_type));
+				}
+				memory_budget.set(MEM_COUNTERS,0);
+				cerr<<"counters spilled to disk ("<<count_spiller.get_spill_num()<<" spills)\n";
+			}
+			double batch_ratio = 1.0;										//下一批的输入和规则占用的内存大致与句子数成正比
+			if (memory_budget.near_limit() && batch_size > MIN_SENTENCE_BATCH_SIZE)
+			{
+				int new_batch_size = max(batch_size/2,MIN_SENTENCE_BATCH_SIZE);
+				batch_ratio = (double)new_batch_size/batch_size;
+				batch_size = new_batch_size;
+				memory_budget.set(MEM_INPUT,input_bytes*batch_ratio);
+				memory_budget.set(MEM_RULES,scheduler.get_peak_live_bytes()*batch_ratio);
+			}
+			// 仍然超限时才减小代价大的句子的组合规则大小；只有抽取到的规则是超限的原因时这样做才有用，
+			// 否则（如一批最少的句子的句法树已经超过上限）只会丢失规则
+			long long rule_growth_bytes = (scheduler.get_peak_live_bytes()-scheduler.get_start_live_bytes())*batch_ratio;
+			if (memory_budget.near_limit() && !memory_budget.near_limit_without(rule_growth_bytes) && expensive_rule_size > 1 && !batch_costs.empty())
+			{
+				if (expensive_rule_size == rule_size_limit)
+				{
+					vector<double> costs = batch_costs;
+					int threshold_idx = costs.size()*(1-EXPENSIVE_SENTENCE_RATIO);
+					nth_element(costs.begin(),costs.begin()+threshold_idx,costs.end());
+					expensive_cost = costs.at(threshold_idx);
+				}
+				expensive_rule_size--;
+				cerr<<"memory pressure: composed rule size limit lowered to "<<expensive_rule_size<<" for sentences with estimated cost >= "<<expensive_cost<<endl;
+			}
+			else if (memory_budget.near_limit() && !budget_warned)
+			{
+				cerr<<"warning: memory budget is too small for a batch of "<<batch_size<<" sentences, composed rules are not reduced since that would not bring memory under the budget\n";
+				budget_warned = true;
+			}
+		}
+		else if (memory_budget.far_below_limit())
+		{
+			batch_size = min(batch_size*2,SENTENCE_BATCH_SIZE);
+			if (expensive_rule_size < rule_size_limit)
+			{
+				expensive_rule_size++;
+				cerr<<"memory pressure relieved: composed rule size limit for expensive sentences raised to "<<expensive_rule_size<<endl;
+			}
+		}
+	}
+	if (dedup)
+	{
+		sentence_cache.report();
+	}
+	if (reduced_sentence_num > 0)											//部分句子只抽取了较小的组合规则，规则表与不限内存时不同
+	{
+		cerr<<"warning: composed rule size limit was reduced from "<<rule_size_limit<<" to "<<min_used_rule_size
+			<<" for "<<reduced_sentence_num<<" expensive sentences to stay within the memory budget, the rule table is incomplete\n";
+	}
+	cerr<<"scheduler: "<<scheduler.get_stolen_task_num()<<" tasks stolen by idle threads\n";
+	if (extract_only)
+	{
+		instance_sink->close();
+		cerr<<instance_sink->get_instance_num()<<" rule instances written\n";
+		delete instance_sink;
+		return 0;
+	}
+	if (!extraction_options.dp_compose)
+	{
+		cerr<<"compose: "<<scheduler.get_avoided_duplicate_num()<<" duplicate composed rules avoided\n";
+	}
+	double counting_seconds = scheduler.get_counting_seconds();
+	cerr<<"counting: "<<scheduler.get_counted_rule_num()<<" rule instances, "<<scheduler.get_counter_update_num()<<" counter updates, "
+		<<(counting_seconds > 0? scheduler.get_counted_rule_num()/counting_seconds : 0)<<" rules/s per thread\n";
+	scheduler.merge_counters(rule_counters);
+	if (count_spiller.get_spill_num() > 0)
+	{
+		count_spiller.spill(rule_counters.at(0));
+		delete rule_counters.at(0);
+		count_spiller.dump_rules();
+	}
+	else
 	{
-		getline(fs,line_str);
-		getline(fa,line_align);
-		//cerr<<line_str<<endl;
-		RuleExtractor rule_extractor(line_tree,line_str,line_align,&lex_s2t,&lex_t2s,&rule_counter);
-		rule_extractor.extract_rules();
+		rule_counters.at(0)->dump_rules();
+		delete rule_counters.at(0);
 	}
-    rule_counter.dump_rules();
 }
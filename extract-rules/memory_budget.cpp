@@ -0,0 +1,71 @@
+#include "memory_budget.h"
+
+MemoryBudget::MemoryBudget(long long max_bytes)
+	: subsystem_bytes(MEM_SUBSYSTEM_NUM,0)
+{
+	this->max_bytes = max_bytes;
+}
+
+long long MemoryBudget::total()
+{
+	long long bytes = 0;
+	for (long long subsystem_byte : subsystem_bytes)
+	{
+		bytes += subsystem_byte;
+	}
+	return bytes;
+}
+
+bool MemoryBudget::near_limit()
+{
+	return max_bytes > 0 && total() > max_bytes*MEMORY_PRESSURE_RATIO;
+}
+
+bool MemoryBudget::near_limit_without(long long bytes)
+{
+	return max_bytes > 0 && total()-bytes > max_bytes*MEMORY_PRESSURE_RATIO;
+}
+
+bool MemoryBudget::far_below_limit()
+{
+	return max_bytes == 0 || total() < max_bytes*MEMORY_PRESSURE_RATIO/2;
+}
+
+// 形如"input 1.2M rules 30.5M counters 200.1M cache 12.0M output 5.0M total 248.8M/1024.0M"的内存使用报告
+string MemoryBudget::report()
+{
+	vector<string> names = {"input","rules","counters","cache","output"};
+	stringstream ss;
+	ss.setf(ios::fixed);
+	ss.precision(1);
+	for (int i=0;i<MEM_SUBSYSTEM_NUM;i++)
+	{
+		ss<<names.at(i)<<" "<<subsystem_bytes.at(i)/1048576.0<<"M ";
+	}
+	ss<<"total "<<total()/1048576.0<<"M";
+	if (max_bytes > 0)
+	{
+		ss<<"/"<<max_bytes/1048576.0<<"M";
+	}
+	return ss.str();
+}
+
+// 解析形如"512M"、"8G"的内存大小，不带单位时为字节数
+long long parse_memory_size(const string &size_str)
+{
+	size_t pos;
+	double size = stod(size_str,&pos);
+	string unit = size_str.substr(pos);
+	if (unit == "K" || unit == "k")
+		size *= 1024;
+	else if (unit == "M" || unit == "m")
+		size *= 1024*1024;
+	else if (unit == "G" || unit == "g")
+		size *= 1024*1024*1024;
+	else if (!unit.empty())
+	{
+		cerr<<"unknown memory size: "<<size_str<<endl;
+		exit(1);
+	}
+	return (long long)size;
+}
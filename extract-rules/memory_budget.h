@@ -0,0 +1,35 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+#include "stdafx.h"
+
+// 分别统计内存的各个子系统
+enum MemorySubsystem {MEM_INPUT,MEM_RULES,MEM_COUNTERS,MEM_CACHE,MEM_OUTPUT,MEM_SUBSYSTEM_NUM};
+
+// 按子系统记录估计的内存使用量，并与内存上限比较；各子系统的值在每批句子处理完后更新，
+// 因此上限是批与批之间的软限制，一批句子处理过程中的峰值可能超过上限
+class MemoryBudget
+{
+	public:
+		MemoryBudget(long long max_bytes);
+		void set(MemorySubsystem subsystem,long long bytes)
+		{
+			subsystem_bytes.at(subsystem) = bytes;
+		}
+		long long get(MemorySubsystem subsystem)
+		{
+			return subsystem_bytes.at(subsystem);
+		}
+		long long total();
+		bool near_limit();													// 是否超过上限的MEMORY_PRESSURE_RATIO
+		bool far_below_limit();												// 是否低于上限的MEMORY_PRESSURE_RATIO的一半
+		bool near_limit_without(long long bytes);							// 释放bytes字节后是否仍超过上限的MEMORY_PRESSURE_RATIO
+		string report();
+
+	private:
+		long long max_bytes;												// 内存上限，0表示不限制
+		vector<long long> subsystem_bytes;
+};
+
+long long parse_memory_size(const string &size_str);
+
+#endif
@@ -38,3 +38,91 @@ void print_vector(vector<int> &v)
 		cout<<e<<" ";
 	cout<<endl;
 }
+
+// 64位FNV-1a哈希
+unsigned long long hash_fnv1a(const char *data,size_t len)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for (size_t i=0;i<len;i++)
+	{
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static inline unsigned long long rotl64(unsigned long long x,int r)
+{
+	return (x<<r)|(x>>(64-r));
+}
+
+static inline unsigned long long fmix64(unsigned long long k)
+{
+	k ^= k>>33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k>>33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k>>33;
+	return k;
+}
+
+// 128位MurmurHash3（x64版本）
+Fingerprint fingerprint_128(const char *data,size_t len)
+{
+	const unsigned long long c1 = 0x87c37b91114253d5ULL;
+	const unsigned long long c2 = 0x4cf5ad432745937fULL;
+	unsigned long long h1 = 0;
+	unsigned long long h2 = 0;
+	size_t block_num = len/16;
+	for (size_t i=0;i<block_num;i++)
+	{
+		unsigned long long k1,k2;
+		memcpy(&k1,data+i*16,8);
+		memcpy(&k2,data+i*16+8,8);
+		k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+		h1 = rotl64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
+		k2 *= c2; k2 = rotl64(k2,33); k2 *= c1; h2 ^= k2;
+		h2 = rotl64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
+	}
+	const unsigned char *tail = (const unsigned char*)(data+block_num*16);
+	unsigned long long k1 = 0;
+	unsigned long long k2 = 0;
+	switch (len&15)
+	{
+		case 15: k2 ^= (unsigned long long)tail[14]<<48;
+		case 14: k2 ^= (unsigned long long)tail[13]<<40;
+		case 13: k2 ^= (unsigned long long)tail[12]<<32;
+		case 12: k2 ^= (unsigned long long)tail[11]<<24;
+		case 11: k2 ^= (unsigned long long)tail[10]<<16;
+		case 10: k2 ^= (unsigned long long)tail[9]<<8;
+		case 9:  k2 ^= (unsigned long long)tail[8];
+				 k2 *= c2; k2 = rotl64(k2,33); k2 *= c1; h2 ^= k2;
+		case 8:  k1 ^= (unsigned long long)tail[7]<<56;
+		case 7:  k1 ^= (unsigned long long)tail[6]<<48;
+		case 6:  k1 ^= (unsigned long long)tail[5]<<40;
+		case 5:  k1 ^= (unsigned long long)tail[4]<<32;
+		case 4:  k1 ^= (unsigned long long)tail[3]<<24;
+		case 3:  k1 ^= (unsigned long long)tail[2]<<16;
+		case 2:  k1 ^= (unsigned long long)tail[1]<<8;
+		case 1:  k1 ^= (unsigned long long)tail[0];
+				 k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+	}
+	h1 ^= len;
+	h2 ^= len;
+	h1 += h2;
+	h2 += h1;
+	h1 = fmix64(h1);
+	h2 = fmix64(h2);
+	h1 += h2;
+	h2 += h1;
+	return {h1,h2};
+}
+
+// 由源端和目标端的指纹得到规则的指纹，不必再对整条规则做哈希
+Fingerprint combine_fingerprints(const Fingerprint &fp1,const Fingerprint &fp2)
+{
+	Fingerprint fp;
+	fp.hi = fmix64(fp1.hi^rotl64(fp2.hi,17)^0x9e3779b97f4a7c15ULL);
+	fp.lo = fmix64(fp1.lo^rotl64(fp2.lo,29)^0x632be59bd9b4e019ULL)+fp.hi;
+	return fp;
+}
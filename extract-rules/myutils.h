@@ -1,6 +1,24 @@
+#ifndef MYUTILS_H
+#define MYUTILS_H
 #include "stdafx.h"
 
+// 128位指纹
+struct Fingerprint
+{
+	unsigned long long hi;
+	unsigned long long lo;
+	bool operator==(const Fingerprint &other) const
+	{
+		return hi == other.hi && lo == other.lo;
+	}
+};
+
 void TrimLine(string &line);
 vector<string> Split(const string &s);
 vector<string> Split(const string &s, const string &sep);
 void print_vector(vector<int> &v);
+unsigned long long hash_fnv1a(const char *data,size_t len);
+Fingerprint fingerprint_128(const char *data,size_t len);
+Fingerprint combine_fingerprints(const Fingerprint &fp1,const Fingerprint &fp2);
+
+#endif
@@ -0,0 +1,74 @@
+#include "numa_topology.h"
+#include <sched.h>
+
+/**************************************************************************************
+ 1. 函数功能: 读取机器的NUMA拓扑
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 依次读取每个节点的cpulist，跳过没有cpu的节点（只有内存的节点）
+************************************************************************************* */
+NumaTopology::NumaTopology()
+{
+	for (int node=0;;node++)
+	{
+		ifstream fin("/sys/devices/system/node/node"+to_string(node)+"/cpulist");
+		if (!fin.is_open())
+			break;
+		string line;
+		getline(fin,line);
+		vector<int> cpus = parse_cpu_list(line);
+		if (!cpus.empty())
+		{
+			node_cpus.push_back(cpus);
+		}
+	}
+	if (node_cpus.empty())
+	{
+		node_cpus.resize(1);
+	}
+}
+
+// 解析形如"0-15,32-47"的cpu列表
+vector<int> NumaTopology::parse_cpu_list(const string &cpu_list)
+{
+	vector<int> cpus;
+	for (auto &range : Split(cpu_list,","))
+	{
+		vector<string> bounds = Split(range,"-");
+		if (bounds.empty() || bounds.front().empty())
+			continue;
+		int first = stoi(bounds.front());
+		int last = stoi(bounds.back());
+		for (int cpu=first;cpu<=last;cpu++)
+		{
+			cpus.push_back(cpu);
+		}
+	}
+	return cpus;
+}
+
+int NumaTopology::node_of_worker(int worker_id,int thread_num)
+{
+	return (long long)worker_id*get_node_num()/thread_num;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将当前线程绑定到工作线程所属节点的所有cpu上
+ 2. 入口参数: 工作线程编号，工作线程总数
+ 3. 出口参数: 是否绑定成功
+ 4. 算法简介: 只绑定到节点而不是单个cpu，节点内由操作系统调度；之后该线程首次写入
+ 			  的内存都分配在本节点上
+************************************************************************************* */
+bool NumaTopology::pin_worker(int worker_id,int thread_num)
+{
+	vector<int> &cpus = node_cpus.at(node_of_worker(worker_id,thread_num));
+	if (cpus.empty())
+		return false;
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	for (int cpu : cpus)
+	{
+		CPU_SET(cpu,&cpu_set);
+	}
+	return sched_setaffinity(0,sizeof(cpu_set),&cpu_set) == 0;
+}
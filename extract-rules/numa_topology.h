@@ -0,0 +1,25 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+#include "stdafx.h"
+#include "myutils.h"
+
+// 机器的NUMA拓扑，从/sys/devices/system/node读取，读取失败时视为只有一个节点
+class NumaTopology
+{
+	public:
+		NumaTopology();
+		int get_node_num()
+		{
+			return node_cpus.size();
+		}
+		int node_of_worker(int worker_id,int thread_num);				// 工作线程按编号分成连续的块，依次放到各节点上
+		bool pin_worker(int worker_id,int thread_num);					// 将当前线程绑定到工作线程所属节点的cpu上
+
+	private:
+		vector<int> parse_cpu_list(const string &cpu_list);
+
+	private:
+		vector<vector<int> > node_cpus;									// 每个节点上的cpu编号
+};
+
+#endif
@@ -0,0 +1,33 @@
+#include "range_query.h"
+
+void SparseTable::build(const vector<int> &vals,bool use_min)
+{
+	values = vals;
+	is_min = use_min;
+	int n = values.size();
+	log_table.assign(n+1,0);
+	for (int i=2;i<=n;i++)
+	{
+		log_table.at(i) = log_table.at(i/2)+1;
+	}
+	table.clear();
+	if (n == 0)
+		return;
+	table.resize(log_table.at(n)+1);
+	table.at(0).resize(n);
+	for (int i=0;i<n;i++)
+	{
+		table.at(0).at(i) = i;
+	}
+	for (int k=1;k<table.size();k++)
+	{
+		int half = 1<<(k-1);
+		table.at(k).resize(n-(1<<k)+1);
+		for (int i=0;i+(1<<k)<=n;i++)
+		{
+			int l = table.at(k-1).at(i);
+			int r = table.at(k-1).at(i+half);
+			table.at(k).at(i) = better(r,l)?r:l;
+		}
+	}
+}
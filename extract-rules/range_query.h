@@ -0,0 +1,48 @@
+#ifndef RANGE_QUERY_H
+#define RANGE_QUERY_H
+#include "stdafx.h"
+
+// 稀疏表，O(nlogn)预处理后以O(1)时间回答区间最小值（或最大值）查询
+class SparseTable
+{
+	public:
+		SparseTable()
+		{
+			is_min = true;
+		}
+		void build(const vector<int> &vals,bool use_min);
+		int query_idx(int lbound,int rbound) const							// 返回区间[lbound,rbound]中最值所在的位置
+		{
+			int k = log_table.at(rbound-lbound+1);
+			int i = table[k][lbound];
+			int j = table[k][rbound-(1<<k)+1];
+			return better(j,i)?j:i;
+		}
+		int query(int lbound,int rbound) const
+		{
+			return values[query_idx(lbound,rbound)];
+		}
+		size_t memory_size() const
+		{
+			size_t bytes = (values.capacity()+log_table.capacity())*sizeof(int);
+			for (auto &row : table)
+			{
+				bytes += sizeof(row)+row.capacity()*sizeof(int);
+			}
+			return bytes;
+		}
+
+	private:
+		bool better(int i,int j) const
+		{
+			return is_min?values[i]<values[j]:values[i]>values[j];
+		}
+
+	private:
+		vector<int> values;
+		vector<vector<int> > table;											// table[k][i]表示区间[i,i+2^k-1]中最值所在的位置
+		vector<int> log_table;
+		bool is_min;
+};
+
+#endif
@@ -1,67 +1,188 @@
 #include "rule_counter.h"
+#include "interned_rule_counter.h"
+#include "fingerprint_rule_counter.h"
+#include "rule_table_writer.h"
 
-void RuleCounter::update(string &rule_src,string &rule_tgt,double lex_weight_t2s,double lex_weight_s2t)
+const size_t MAP_ENTRY_BYTES = 80;                                          // std::map每个节点（含string对象）的大致字节数
+
+/**************************************************************************************
+ 1. 函数功能: 创建指定类型的规则计数器
+ 2. 入口参数: 计数器类型，map、interned或fingerprint
+ 3. 出口参数: 计数器
+ 4. 算法简介: 无
+************************************************************************************* */
+RuleCounter* create_rule_counter(const string &counter_type)
+{
+    if (counter_type == "map")
+        return new MapRuleCounter;
+    if (counter_type == "interned")
+        return new InternedRuleCounter;
+    if (counter_type == "fingerprint")
+        return new FingerprintRuleCounter;
+    cerr<<"unknown counter type: "<<counter_type<<endl;
+    exit(1);
+}
+
+MapRuleCounter::MapRuleCounter()
+{
+    key_bytes = 0;
+}
+
+// 更新一条规则的计数，词汇权重按次数加权累加
+void RuleCounter::update(string &rule_src,string &rule_tgt,double lex_weight_t2s,double lex_weight_s2t,double count)
+{
+    update_stat(rule_src,rule_tgt,{count,count*lex_weight_t2s,count*lex_weight_s2t});
+}
+
+void MapRuleCounter::update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat)
 {
     string rule = rule_src+" ||| "+rule_tgt;
     auto it1 = rule2count_and_accumulate_lex_weight.find(rule);
     if (it1 != rule2count_and_accumulate_lex_weight.end())
     {
-        it1->second.count += 1;
-        it1->second.acc_lex_weight_t2s += lex_weight_t2s;
-        it1->second.acc_lex_weight_s2t += lex_weight_s2t;
+        it1->second.count += stat.count;
+        it1->second.acc_lex_weight_t2s += stat.acc_lex_weight_t2s;
+        it1->second.acc_lex_weight_s2t += stat.acc_lex_weight_s2t;
     }
     else
     {
-        rule2count_and_accumulate_lex_weight[rule] = {1,lex_weight_t2s,lex_weight_s2t};
+        rule2count_and_accumulate_lex_weight[rule] = stat;
+        key_bytes += rule.size();
     }
+    add_count(rule_src2count,rule_src,stat.count);
+    add_count(rule_tgt2count,rule_tgt,stat.count);
+    add_count(root2count,rule_src.substr(0,rule_src.find(" ")),stat.count);
+}
 
-    auto it2 = rule_src2count.find(rule_src);
-    if (it2 != rule_src2count.end())
+void MapRuleCounter::add_count(map<string,double> &key2count,const string &key,double count)
+{
+    auto it = key2count.find(key);
+    if (it != key2count.end())
     {
-        it2->second += 1;
+        it->second += count;
     }
     else
     {
-        rule_src2count[rule_src] = 1;
+        key2count[key] = count;
+        key_bytes += key.size();
     }
+}
 
-    auto it3 = rule_tgt2count.find(rule_tgt);
-    if (it3 != rule_tgt2count.end())
+/**************************************************************************************
+ 1. 函数功能: 用一个句子的所有规则更新计数
+ 2. 入口参数: 规则列表，该句子在语料中重复出现的次数
+ 3. 出口参数: 无
+ 4. 算法简介: 重复的句子只抽取一次，每条规则的次数乘以重复次数
+************************************************************************************* */
+void RuleCounter::update(vector<RuleRecord> &rule_records,double multiplicity)
+{
+    for (auto &record : rule_records)
     {
-        it3->second += 1;
+        update(record.rule_src,record.rule_tgt,record.lex_weight_s2t,record.lex_weight_t2s,record.count*multiplicity);
     }
-    else
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将另一个计数器的统计结果累加到当前计数器中
+ 2. 入口参数: 另一个计数器
+ 3. 出口参数: 无
+ 4. 算法简介: 用于合并多个线程各自的计数结果
+************************************************************************************* */
+void MapRuleCounter::merge(RuleCounter &other_counter)
+{
+    MapRuleCounter &other = dynamic_cast<MapRuleCounter&>(other_counter);
+    for (auto &kvp : other.rule2count_and_accumulate_lex_weight)
     {
-        rule_tgt2count[rule_tgt] = 1;
+        auto it = rule2count_and_accumulate_lex_weight.find(kvp.first);
+        if (it != rule2count_and_accumulate_lex_weight.end())
+        {
+            it->second.count += kvp.second.count;
+            it->second.acc_lex_weight_t2s += kvp.second.acc_lex_weight_t2s;
+            it->second.acc_lex_weight_s2t += kvp.second.acc_lex_weight_s2t;
+        }
+        else
+        {
+            rule2count_and_accumulate_lex_weight[kvp.first] = kvp.second;
+            key_bytes += kvp.first.size();
+        }
     }
-
-    string root = rule_src.substr(0,rule_src.find(" "));
-    auto it4 = root2count.find(root);
-    if (it4 != root2count.end())
+    for (auto &kvp : other.rule_src2count)
     {
-        it4->second += 1;
+        add_count(rule_src2count,kvp.first,kvp.second);
     }
-    else
+    for (auto &kvp : other.rule_tgt2count)
+    {
+        add_count(rule_tgt2count,kvp.first,kvp.second);
+    }
+    for (auto &kvp : other.root2count)
     {
-        root2count[root] = 1;
+        add_count(root2count,kvp.first,kvp.second);
     }
 }
 
-void RuleCounter::dump_rules()
+// map已经有序，只需并行格式化；各线程同时查询计数，因此用at而不用[]
+void MapRuleCounter::dump_rules()
 {
+    vector<const pair<const string,CountAndLexWeight>*> entries;
+    entries.reserve(rule2count_and_accumulate_lex_weight.size());
     for (auto &kvp : rule2count_and_accumulate_lex_weight)
     {
-        string rule = kvp.first;
+        entries.push_back(&kvp);
+    }
+    write_rule_table(entries.size(),[&](size_t i,ostream &out){
+        const string &rule = entries[i]->first;
+        const CountAndLexWeight &stat = entries[i]->second;
         vector<string> vs = Split(rule," ||| ");
         string &rule_src = vs[0];
         string &rule_tgt = vs[1];
         string root = rule_src.substr(0,rule_src.find(" "));
-        double rule_count = (double)kvp.second.count;
-        double lex_weight_t2s = kvp.second.acc_lex_weight_t2s/rule_count;
-        double lex_weight_s2t = kvp.second.acc_lex_weight_s2t/rule_count;
-        double trans_prob_t2s = rule_count/rule_src2count[rule_src];
-        double trans_prob_s2t = rule_count/rule_tgt2count[rule_tgt];
-        double root2rule_prob = rule_count/root2count[root];
-        cout<<rule<<" ||| "<<root2rule_prob<<" "<<trans_prob_t2s<<" "<<trans_prob_s2t<<" "<<lex_weight_t2s<<" "<<lex_weight_s2t<<endl;
+        double rule_count = stat.count;
+        double lex_weight_t2s = stat.acc_lex_weight_t2s/rule_count;
+        double lex_weight_s2t = stat.acc_lex_weight_s2t/rule_count;
+        double trans_prob_t2s = rule_count/rule_src2count.at(rule_src);
+        double trans_prob_s2t = rule_count/rule_tgt2count.at(rule_tgt);
+        double root2rule_prob = rule_count/root2count.at(root);
+        out<<rule<<" ||| "<<root2rule_prob<<" "<<trans_prob_t2s<<" "<<trans_prob_s2t<<" "<<lex_weight_t2s<<" "<<lex_weight_s2t<<"\n";
+    },cout);
+}
+
+void MapRuleCounter::collect_rules(vector<ScoredRule> &scored_rules)
+{
+    scored_rules.clear();
+    for (auto &kvp : rule2count_and_accumulate_lex_weight)
+    {
+        vector<string> vs = Split(kvp.first," ||| ");
+        string &rule_src = vs[0];
+        string &rule_tgt = vs[1];
+        string root = rule_src.substr(0,rule_src.find(" "));
+        double rule_count = kvp.second.count;
+        scored_rules.push_back({rule_src,rule_tgt,rule_count,rule_count/root2count[root],rule_count/rule_src2count[rule_src],
+                                rule_count/rule_tgt2count[rule_tgt],kvp.second.acc_lex_weight_t2s/rule_count,kvp.second.acc_lex_weight_s2t/rule_count});
+    }
+}
+
+void MapRuleCounter::write_counts(ostream &out)
+{
+    out.precision(17);
+    for (auto &kvp : rule2count_and_accumulate_lex_weight)                  // 以"源端 ||| 目标端"排序与按（源端，目标端）排序相同
+    {
+        out<<kvp.first<<" ||| "<<kvp.second.count<<" "<<kvp.second.acc_lex_weight_t2s<<" "<<kvp.second.acc_lex_weight_s2t<<"\n";
+    }
+}
+
+size_t MapRuleCounter::memory_size()
+{
+    size_t entry_num = rule2count_and_accumulate_lex_weight.size()+rule_src2count.size()+rule_tgt2count.size()+root2count.size();
+    return entry_num*MAP_ENTRY_BYTES+key_bytes;
+}
+
+// 估计一个句子的规则字符串占用的内存字节数
+size_t rule_records_memory_size(vector<RuleRecord> &rule_records)
+{
+    size_t bytes = rule_records.capacity()*sizeof(RuleRecord);
+    for (auto &record : rule_records)
+    {
+        bytes += record.rule_src.capacity()+record.rule_tgt.capacity();
     }
+    return bytes;
 }
@@ -5,22 +5,74 @@
 
 struct CountAndLexWeight
 {
-    int count;
+    double count;
     double acc_lex_weight_t2s;
     double acc_lex_weight_s2t;
 };
 
+// 一条规则实例的字符串形式及词汇权重
+struct RuleRecord
+{
+    string rule_src;
+    string rule_tgt;
+    double lex_weight_s2t;
+    double lex_weight_t2s;
+    double count;                                   // 规则出现的次数，k-best输入时为分数
+    int type;                                       // 规则类型，与Rule::type相同
+};
+
+// 规则表中的一条规则及其特征，与dump_rules输出的一行对应
+struct ScoredRule
+{
+    string rule_src;
+    string rule_tgt;
+    double count;
+    double root2rule_prob;
+    double trans_prob_t2s;
+    double trans_prob_s2t;
+    double lex_weight_t2s;
+    double lex_weight_s2t;
+};
+
+// 规则计数器的接口，不同的实现使用不同的存储方式
 class RuleCounter
 {
     public:
-        void update(string &rule_src,string &rule_tgt,double lex_weight_t2s,double lex_weight_s2t);
+        virtual ~RuleCounter() {}
+        void update(string &rule_src,string &rule_tgt,double lex_weight_t2s,double lex_weight_s2t,double count);
+        void update(vector<RuleRecord> &rule_records,double multiplicity);
+        virtual void update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat) = 0;   // 直接累加已经乘过次数的统计量，批量更新时用
+        virtual void merge(RuleCounter &other) = 0;                 // other必须与当前计数器类型相同
+        virtual void dump_rules() = 0;
+        virtual void collect_rules(vector<ScoredRule> &scored_rules) = 0;  // 按照dump_rules的顺序在内存中返回规则表
+        virtual void write_counts(ostream &out) = 0;                // 按照（源端，目标端）的顺序写出每条规则累加的次数及词汇权重
+        virtual size_t memory_size() = 0;                           // 估计占用的内存字节数
+};
+
+// 以完整的规则字符串为键，规则、源端、目标端分别存放在std::map中
+class MapRuleCounter : public RuleCounter
+{
+    public:
+        MapRuleCounter();
+        void update_stat(string &rule_src,string &rule_tgt,const CountAndLexWeight &stat);
+        void merge(RuleCounter &other);
         void dump_rules();
+        void collect_rules(vector<ScoredRule> &scored_rules);
+        void write_counts(ostream &out);
+        size_t memory_size();
 
     private:
+        void add_count(map<string,double> &key2count,const string &key,double count);
+
+    private:
+        size_t key_bytes;                                           // 四个map中所有键的字节数
         map<string,CountAndLexWeight> rule2count_and_accumulate_lex_weight;
-        map<string,int> rule_src2count;
-        map<string,int> rule_tgt2count;
-        map<string,int> root2count;
+        map<string,double> rule_src2count;
+        map<string,double> rule_tgt2count;
+        map<string,double> root2count;
 };
 
+RuleCounter* create_rule_counter(const string &counter_type);
+size_t rule_records_memory_size(vector<RuleRecord> &rule_records);
+
 #endif
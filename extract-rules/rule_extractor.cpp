@@ -1,89 +1,272 @@
 #include "rule_extractor.h"
 
-RuleExtractor::RuleExtractor(string &line_tree,string &line_str,string &line_align,map<string,double> *lex_s2t,map<string,double> *lex_t2s,RuleCounter *counter)
+RuleExtractor::RuleExtractor(string &line_tree,string &line_str,string &line_align,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s)
 {
-	tspair = new TreeStrPair(line_tree,line_str,line_align,lex_s2t,lex_t2s,counter);
+	tspair = new TreeStrPair(line_tree,line_str,line_align,lex_s2t,lex_t2s);
+	multiplicity = 1;
+	sentence_id = 0;
+	max_rule_size = MAX_RULE_SIZE;
+	max_lhs_node_num = MAX_LHS_NODE_NUM;
+	dp_compose = false;
+	avoided_duplicate_num = 0;
+}
+
+RuleExtractor::RuleExtractor(vector<string> &lines_tree,vector<double> &tree_weights,string &line_str,string &line_align,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s)
+{
+	tspair = new TreeStrPair(lines_tree,tree_weights,line_str,line_align,lex_s2t,lex_t2s);
+	multiplicity = 1;
+	sentence_id = 0;
+	max_rule_size = MAX_RULE_SIZE;
+	max_lhs_node_num = MAX_LHS_NODE_NUM;
+	dp_compose = false;
+	avoided_duplicate_num = 0;
+}
+
+RuleExtractor::RuleExtractor(ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s)
+{
+	tspair = new TreeStrPair(tree,tgt_words,alignment,lex_s2t,lex_t2s);
+	multiplicity = 1;
+	sentence_id = 0;
+	max_rule_size = MAX_RULE_SIZE;
+	max_lhs_node_num = MAX_LHS_NODE_NUM;
+	dp_compose = false;
+	avoided_duplicate_num = 0;
+}
+
+// 按照抽取设置限制组合规则，句法树的输入格式在构造时已经确定
+void RuleExtractor::set_options(const ExtractionOptions &options)
+{
+	max_rule_size = options.max_rule_size;
+	max_lhs_node_num = options.max_lhs_node_num;
+	dp_compose = options.dp_compose;
 }
 
 void RuleExtractor::extract_rules()
 {
-	extract_GHKM_rules(tspair->root);
-	extract_SPMT_rules();
-	extract_compose_rules(tspair->root);
-	tspair->dump_all_rules(tspair->root);
+	if (tspair->roots.empty())
+		return;
+	if (tspair->node_num() < MIN_NODE_NUM_FOR_PARALLEL || (omp_get_max_threads() == 1 && !omp_in_parallel()))
+	{
+		extract_GHKM_rules();
+		extract_SPMT_rules();
+		extract_compose_rules();
+		tspair->dump_all_rules(rule_records);
+	}
+	else if (omp_in_parallel())										//已经处于并行区域中，直接向当前线程组的任务池提交任务
+	{
+		extract_rules_in_parallel();
+	}
+	else
+	{
+#pragma omp parallel
+#pragma omp single
+		extract_rules_in_parallel();
+	}
 }
 
 /**************************************************************************************
- 1. 函数功能: 抽取当前子树包含的最小规则
- 2. 入口参数: 当前子树的根节点
+ 1. 函数功能: 将frontier_nodes分块，每块作为一个任务提交到当前线程组的任务池，等待
+ 			  所有任务完成后返回
+ 2. 入口参数: 待处理的节点，对每个节点调用的函数
  3. 出口参数: 无
- 4. 算法简介: 先序遍历当前子树，抽取每个每个节点的最小规则
+ 4. 算法简介: 见注释
 ************************************************************************************* */
-void RuleExtractor::extract_GHKM_rules(SyntaxNode* node)
+static void for_each_node_in_parallel(vector<int> &frontier_nodes,const function<void(int)> &func)
 {
-	if (node->type == 1) 													// 当前节点为边界节点
+	const function<void(int)> *pfunc = &func;
+	int node_num = frontier_nodes.size();
+	int grain = max(1,node_num/(omp_get_num_threads()*TASK_NUM_PER_THREAD));
+	for (int beg=0;beg<node_num;beg+=grain)
 	{
-		Rule rule;
-		rule.type = 1;
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(-1);
-		rule.src_node_span.push_back(node->tgt_span);
-		rule.tgt_word_status.resize(tspair->tgt_sen_len,-1);
-		rule.variable_num = 0;
-		for (const auto child : node->children) 							// 对当前节点的每个孩子节点进行扩展，直到遇到边界节点或单词节点为止
+		int end = min(node_num,beg+grain);
+#pragma omp task firstprivate(beg,end,pfunc)
+		for (int i=beg;i<end;i++)
 		{
-			find_frontier_frag(child,rule);
+			(*pfunc)(i);
 		}
-		cal_tgt_word_num(rule);
-		if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= MAX_LHS_NODE_NUM)
+	}
+#pragma omp taskwait
+}
+
+/**************************************************************************************
+ 1. 函数功能: 在句子内部并行抽取规则，用于节点数很多的句法树
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 每个边界节点的最小规则只依赖于其子树，组合规则只依赖于其子孙节点的
+ 			  最小规则，因此可以按节点划分任务
+			  1) 并行抽取每个边界节点的最小规则
+			  2) 串行抽取SPMT规则
+			  3) 并行计算每个边界节点的组合规则，先放入临时数组，全部完成后再加入
+			     节点的规则列表，避免读写冲突
+			  4) 并行生成每个节点规则的字符串形式
+************************************************************************************* */
+void RuleExtractor::extract_rules_in_parallel()
+{
+	vector<int> frontier_nodes;
+	for (int node=0;node<tspair->node_num();node++)
+	{
+		if (tspair->node_types.at(node) == 1 && tspair->node_canonical.at(node) == node)
 		{
-			node->rules.push_back(rule);
+			frontier_nodes.push_back(node);
 		}
-		if (!node->rules.empty())
+	}
+	for_each_node_in_parallel(frontier_nodes,[&](int i){extract_minimal_rules_for_node(frontier_nodes.at(i));});
+	extract_SPMT_rules();
+	vector<vector<Rule> > composed_rules(frontier_nodes.size());
+	if (dp_compose)															//推导表之间有依赖，先串行建好，组合时只读
+	{
+		for (int node : frontier_nodes)
 		{
-			attach_unaligned_words(node);
+			build_derivations(node);
 		}
 	}
-	for (const auto child : node->children)
+	for_each_node_in_parallel(frontier_nodes,[&](int i){compose_rules_for_node(frontier_nodes.at(i),composed_rules.at(i));});
+	vector<vector<RuleRecord> > node_rule_records(frontier_nodes.size());
+	for_each_node_in_parallel(frontier_nodes,[&](int i){
+		vector<Rule> &rules = tspair->node_rules.at(frontier_nodes.at(i));
+		rules.insert(rules.end(),composed_rules.at(i).begin(),composed_rules.at(i).end());
+		for (auto &rule : rules)
+		{
+			tspair->dump_rule(rule,node_rule_records.at(i));
+		}
+	});
+	for (auto &records : node_rule_records)
 	{
-		extract_GHKM_rules(child);
+		rule_records.insert(rule_records.end(),records.begin(),records.end());
 	}
+	vector<NodeDerivations>().swap(node_derivations);
 }
 
 /**************************************************************************************
- 1. 函数功能: 寻找当前节点的最小规则片段，并更新目标端单词状态
- 2. 入口参数: 当前子树的根节点
- 3. 出口参数: 源端规则片段，目标端单词状态，变量个数
- 4. 算法简介: 如果当前节点为单词节点或者边界节点，则停止扩展，否则对子树进行先序遍历
+ 1. 函数功能: 用抽取到的规则更新计数器
+ 2. 入口参数: 计数器
+ 3. 出口参数: 无
+ 4. 算法简介: 每条规则的次数乘以句子的重复次数；计数器不是线程安全的，调用者需保证同一时刻只有一个线程使用该计数器
 ************************************************************************************* */
-void RuleExtractor::find_frontier_frag(SyntaxNode* node,Rule &rule)
+void RuleExtractor::count_rules(RuleCounter *counter)
+{
+	counter->update(rule_records,multiplicity);
+}
+
+// 批量计数时先把规则实例放入工作线程的缓冲区，由调用者在缓冲区写满时写入计数器
+void RuleExtractor::count_rules(CounterUpdateBuffer *buffer)
 {
-	if (node->type == 0) 																//单词节点
+	buffer->add(rule_records,multiplicity);
+}
+
+// 只抽取不计数时，将规则实例写入输出；多个线程可以同时调用，每个线程使用自己的缓冲区
+void RuleExtractor::write_instances(InstanceSink *sink,int worker_id)
+{
+	sink->write(worker_id,sentence_id,multiplicity,rule_records);
+}
+
+void RuleExtractor::take_rule_records(vector<RuleRecord> &records)
+{
+	records.swap(rule_records);
+	rule_records.clear();
+}
+
+/**************************************************************************************
+ 1. 函数功能: 估计抽取当前句子所需的时间，用于调度
+ 2. 入口参数: 无
+ 3. 出口参数: 估计的代价
+ 4. 算法简介: 最小规则抽取与节点数成正比，SPMT规则抽取与目标端句长成正比，组合规则
+ 			  抽取与边界节点数成正比，但每个边界节点的代价要高得多
+************************************************************************************* */
+double RuleExtractor::estimate_cost()
+{
+	int frontier_node_num = 0;
+	for (int node=0;node<tspair->node_num();node++)
 	{
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(-3);
-		rule.src_node_span.push_back(node->tgt_span);
+		if (tspair->node_types.at(node) == 1 && tspair->node_canonical.at(node) == node)
+		{
+			frontier_node_num++;
+		}
 	}
-	else if (node->type == 1)										                    //边界节点
+	return tspair->node_num() + tspair->tgt_sen_len*MAX_SPMT_PHRASE_LEN + frontier_node_num*max_rule_size*max_rule_size;
+}
+
+size_t RuleExtractor::memory_size()
+{
+	return sizeof(*this)+tspair->memory_size()+rule_records_memory_size(rule_records);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 抽取所有节点的最小规则
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 按先序顺序抽取每个边界节点的最小规则，多棵句法树共享的节点只抽取一次
+************************************************************************************* */
+void RuleExtractor::extract_GHKM_rules()
+{
+	for (int node=0;node<tspair->node_num();node++)
 	{
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(rule.variable_num);
-		rule.src_node_span.push_back(node->tgt_span);
-		for (int tgt_idx=node->tgt_span.first;tgt_idx<=node->tgt_span.second;tgt_idx++)
+		if (tspair->node_types.at(node) == 1 && tspair->node_canonical.at(node) == node) 	// 当前节点为边界节点，且是代表节点
 		{
-			rule.tgt_word_status.at(tgt_idx) = rule.variable_num;						//根据当前节点的tgt_span更新目标端单词的状态
+			extract_minimal_rules_for_node(node);
 		}
-		rule.variable_num++;
 	}
-	else if (node->type == 2)              											    //非边界节点
+}
+
+void RuleExtractor::extract_minimal_rules_for_node(int node)
+{
+	Rule rule;
+	rule.type = 1;
+	rule.src_tree_frag.push_back(node);
+	rule.src_node_status.push_back(-1);
+	rule.src_node_span.push_back(tspair->node_tgt_spans.at(node));
+	rule.tgt_word_status.resize(tspair->tgt_sen_len,-1);
+	rule.variable_num = 0;
+	find_frontier_frag(node,rule);											// 对当前节点的子树进行扩展，直到遇到边界节点或单词节点为止
+	cal_tgt_word_num(rule);
+	vector<Rule> &rules = tspair->node_rules.at(node);
+	if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= max_lhs_node_num)
+	{
+		rules.push_back(rule);
+	}
+	if (!rules.empty())
+	{
+		attach_unaligned_words(node);
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 寻找当前节点的最小规则片段，并更新目标端单词状态
+ 2. 入口参数: 当前子树的根节点
+ 3. 出口参数: 源端规则片段，目标端单词状态，变量个数
+ 4. 算法简介: 先序扫描当前节点的子树，遇到单词节点或者边界节点时停止扩展，跳过其子树
+************************************************************************************* */
+void RuleExtractor::find_frontier_frag(int node,Rule &rule)
+{
+	int subtree_end = tspair->node_subtree_ends.at(node);
+	for (int cur=node+1;cur<subtree_end;)
 	{
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(-2);
-		rule.src_node_span.push_back(make_pair(-1,-1));
-		for (const auto child : node->children)
+		int type = tspair->node_types.at(cur);
+		rule.src_tree_frag.push_back(cur);
+		if (type == 0) 																	//单词节点
 		{
-			find_frontier_frag(child,rule);
+			rule.src_node_status.push_back(-3);
+			rule.src_node_span.push_back(tspair->node_tgt_spans.at(cur));
 		}
+		else if (type == 1)										                    	//边界节点
+		{
+			pair<int,int> tgt_span = tspair->node_tgt_spans.at(cur);
+			rule.src_node_status.push_back(rule.variable_num);
+			rule.src_node_span.push_back(tgt_span);
+			for (int tgt_idx=tgt_span.first;tgt_idx<=tgt_span.second;tgt_idx++)
+			{
+				rule.tgt_word_status.at(tgt_idx) = rule.variable_num;					//根据当前节点的tgt_span更新目标端单词的状态
+			}
+			rule.variable_num++;
+		}
+		else              											    				//非边界节点，继续扫描其孩子
+		{
+			rule.src_node_status.push_back(-2);
+			rule.src_node_span.push_back(make_pair(-1,-1));
+			cur++;
+			continue;
+		}
+		cur = tspair->node_subtree_ends.at(cur);
 	}
 }
 
@@ -104,8 +287,9 @@ void RuleExtractor::cal_tgt_word_num(Rule &rule)
  3. 出口参数: 无
  4. 算法简介: 见注释
 ************************************************************************************* */
-void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
+void RuleExtractor::attach_unaligned_words(int node)
 {
+	vector<Rule> &rules = tspair->node_rules.at(node);
 	for (int tgt_idx=0;tgt_idx<tspair->tgt_sen_len;tgt_idx++)									//遍历目标语言句子的所有单词
 	{
 		if (tspair->tgt_idx_to_src_idx.at(tgt_idx).size() > 0)       							//跳过有对齐的单词
@@ -118,19 +302,19 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 		}
 		if (i>=0) 											 									//左边有单词有对齐
 		{
-			for (int j=0;j<node->rules.front().src_tree_frag.size();j++)	    				//遍历最小规则的每个节点，检查能否被依附
+			for (int j=0;j<rules.front().src_tree_frag.size();j++)	    				//遍历最小规则的每个节点，检查能否被依附
 			{
-				if (node->rules.front().src_tree_frag.at(j)->tgt_span.second == i				//被检查节点的右边界等于i
-					&& node->rules.front().src_tree_frag.at(j)->type == 1)						//被检查节点为边界节点
+				if (tspair->node_tgt_spans.at(rules.front().src_tree_frag.at(j)).second == i				//被检查节点的右边界等于i
+					&& tspair->node_types.at(rules.front().src_tree_frag.at(j)) == 1)						//被检查节点为边界节点
 				{
-					Rule rule = node->rules.front();
+					Rule rule = rules.front();
 					rule.type = 2;
 					if (rule.src_node_span.at(0).second < tgt_idx)
 					{
 						rule.src_node_span.at(0).second = tgt_idx;								//更新规则根节点的目标端span
 					}
 					rule.src_node_span.at(j).second = tgt_idx;									//更新变量节点的在目标端的控制范围
-					int variable_idx = node->rules.front().src_node_status.at(j);
+					int variable_idx = rules.front().src_node_status.at(j);
 					if (variable_idx >= 0)
 					{
 						for (int k=rule.src_node_span.at(j).first;k<=rule.src_node_span.at(j).second;k++)
@@ -139,9 +323,9 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 						}
 					}
 					cal_tgt_word_num(rule);
-					if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= MAX_LHS_NODE_NUM)
+					if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= max_lhs_node_num)
 					{
-						node->rules.push_back(rule);
+						rules.push_back(rule);
 					}
 				}
 			}
@@ -154,19 +338,19 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 		}
 		if (i < tspair->tgt_sen_len) 															//右边有单词有对齐
 		{
-			for (int j=0;j<node->rules.front().src_tree_frag.size();j++)	    				//遍历最小规则的每个节点，检查能否被依附
+			for (int j=0;j<rules.front().src_tree_frag.size();j++)	    				//遍历最小规则的每个节点，检查能否被依附
 			{
-				if (node->rules.front().src_tree_frag.at(j)->tgt_span.first == i				//被检查节点的左边界等于i
-					&& node->rules.front().src_tree_frag.at(j)->type == 1)						//被检查节点为边界节点
+				if (tspair->node_tgt_spans.at(rules.front().src_tree_frag.at(j)).first == i				//被检查节点的左边界等于i
+					&& tspair->node_types.at(rules.front().src_tree_frag.at(j)) == 1)						//被检查节点为边界节点
 				{
-					Rule rule = node->rules.front();
+					Rule rule = rules.front();
 					rule.type = 2;
 					if (rule.src_node_span.at(0).first > tgt_idx)
 					{
 						rule.src_node_span.at(0).first = tgt_idx;								//更新规则根节点的目标端span
 					}
 					rule.src_node_span.at(j).first = tgt_idx;									//更新变量节点的在目标端的控制范围
-					int variable_idx = node->rules.front().src_node_status.at(j);
+					int variable_idx = rules.front().src_node_status.at(j);
 					if (variable_idx >= 0)
 					{
 						for (int k=rule.src_node_span.at(j).first;k<=rule.src_node_span.at(j).second;k++)
@@ -175,9 +359,9 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 						}
 					}
 					cal_tgt_word_num(rule);
-					if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= MAX_LHS_NODE_NUM)
+					if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= max_lhs_node_num)
 					{
-						node->rules.push_back(rule);
+						rules.push_back(rule);
 					}
 				}
 			}
@@ -186,7 +370,7 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 }
 
 /**************************************************************************************
- 1. 函数功能: 抽取目标语言每一个span对应的句法短语规则
+ 1. 函数功能: 在建立了索引的句法树中抽取目标语言每一个span对应的句法短语规则
  2. 入口参数: 无
  3. 出口参数: 无
  4. 算法简介: 遍历目标语言每一个span
@@ -195,6 +379,18 @@ void RuleExtractor::attach_unaligned_words(SyntaxNode* node)
 			  3) 先序遍历句法子树，找出规则源端
 ************************************************************************************* */
 void RuleExtractor::extract_SPMT_rules()
+{
+	for (int i=0;i<tspair->roots.size();i++)								//SPMT规则依赖于覆盖源端span的最低节点，需要对每棵句法树分别抽取
+	{
+		if (i > 0)
+		{
+			tspair->build_tree_index(tspair->roots.at(i));
+		}
+		extract_SPMT_rules_in_tree();
+	}
+}
+
+void RuleExtractor::extract_SPMT_rules_in_tree()
 {
 	for (int len=0;len<tspair->tgt_sen_len && len<MAX_SPMT_PHRASE_LEN;len++)	  //遍历目标端所有的短语
 	{
@@ -207,13 +403,8 @@ void RuleExtractor::extract_SPMT_rules()
 			bool flag = check_alignment_for_src_span(src_span,tgt_span);	      //检查源端span中的单词是否对到了目标端span的外面
 			if (flag == false)
 				continue;
-			//寻找能覆盖源端span的最低句法节点
-			SyntaxNode *node = tspair->word_nodes.at(src_span.first)->father;     //从源端span最左端单词的词性节点往上找
-			while (node->src_span.second < src_span.second) 					  //当前节点无法覆盖源端span右边界（左边界肯定能被覆盖）
-			{
-				node = node->father;
-			}
-			if (node->type != 1)                								  //找到的根节点不是边界节点
+			int node = tspair->find_lowest_covering_node(src_span);      		  //寻找能覆盖源端span的最低句法节点
+			if (tspair->node_types.at(node) != 1)                								  //找到的根节点不是边界节点
 				continue;
 			//先序遍历以当前节点为根节点的子树，找出规则源端
 			Rule rule;
@@ -223,16 +414,11 @@ void RuleExtractor::extract_SPMT_rules()
 			rule.src_node_span.push_back(tgt_span);
 			rule.tgt_word_status.resize(tspair->tgt_sen_len,-1);
 			rule.variable_num = 0;
-			for (const auto child : node->children) 							 // 对当前节点的每个孩子节点进行扩展，直到遇到源端span以外的边界节点或单词节点
-			{
-				flag = find_syntax_phrase_frag(child,rule,src_span);
-				if (flag == false)
-					break;
-			}
+			flag = find_syntax_phrase_frag(node,rule,src_span);				 // 对当前节点的子树进行扩展，直到遇到源端span以外的边界节点或单词节点
 			if (flag == false)
 				continue;
-			int lbound = min(tgt_span.first,node->tgt_span.first);               // 当前规则的左右边界
-			int rbound = max(tgt_span.second,node->tgt_span.second);
+			int lbound = min(tgt_span.first,tspair->node_tgt_spans.at(node).first);               // 当前规则的左右边界
+			int rbound = max(tgt_span.second,tspair->node_tgt_spans.at(node).second);
 			rule.src_node_span.at(0) = make_pair(lbound,rbound);
 			for (int tgt_idx=lbound;tgt_idx<=rbound;tgt_idx++)
 			{
@@ -242,9 +428,9 @@ void RuleExtractor::extract_SPMT_rules()
 				}
 			}
 			cal_tgt_word_num(rule);
-			if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= MAX_LHS_NODE_NUM)
+			if (rule.tgt_word_num <= MAX_RHS_WORD_NUM && rule.src_tree_frag.size() <= max_lhs_node_num)
 			{
-				node->rules.push_back(rule);
+				tspair->node_rules.at(tspair->node_canonical.at(node)).push_back(rule);	//k-best输入时规则放在代表节点上
 			}
 		}
 	}
@@ -254,130 +440,166 @@ void RuleExtractor::extract_SPMT_rules()
  1. 函数功能: 寻找当前节点的句法短语规则片段，并更新目标端单词状态
  2. 入口参数: 当前子树的根节点
  3. 出口参数: 成功标识，源端规则片段，目标端单词状态，变量个数
- 4. 算法简介: 如果当前节点为超过源端span的边界节点，则停止扩展，否则对子树进行先序遍历
+ 4. 算法简介: 先序扫描当前节点的子树，遇到超过源端span的边界节点时停止扩展，跳过其子树
  			  如果超过源端span的节点为非边界节点，则返回错误
 ************************************************************************************* */
-bool RuleExtractor::find_syntax_phrase_frag(SyntaxNode* node,Rule &rule,pair<int,int> src_span)
+bool RuleExtractor::find_syntax_phrase_frag(int node,Rule &rule,pair<int,int> src_span)
 {
-	if (node->type == 0) 																//单词节点
+	int subtree_end = tspair->node_subtree_ends.at(node);
+	for (int cur=node+1;cur<subtree_end;)
 	{
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(-3);
-		rule.src_node_span.push_back(node->tgt_span);
-	}
-	else if (node->type == 1 && (node->src_span.first > src_span.second || node->src_span.second < src_span.first))   //超过了源端span的边界节点
-	{
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(rule.variable_num);
-		rule.src_node_span.push_back(node->tgt_span);
-		for (int tgt_idx=node->tgt_span.first;tgt_idx<=node->tgt_span.second;tgt_idx++)
+		int type = tspair->node_types.at(cur);
+		pair<int,int> cur_src_span = tspair->node_src_spans.at(cur);
+		pair<int,int> tgt_span = tspair->node_tgt_spans.at(cur);
+		bool out_of_span = cur_src_span.first > src_span.second || cur_src_span.second < src_span.first;
+		rule.src_tree_frag.push_back(cur);
+		if (type == 0) 																	//单词节点
 		{
-			rule.tgt_word_status.at(tgt_idx) = rule.variable_num;						//根据当前节点的tgt_span更新目标端单词的状态
+			rule.src_node_status.push_back(-3);
+			rule.src_node_span.push_back(tgt_span);
 		}
-		rule.variable_num++;
-	}
-	else 																				//非边界节点或源端span内的边界节点
-	{
-		if (node->type == 2 && (node->src_span.first > src_span.second || node->src_span.second < src_span.first))  //超过了源端span的非边界节点
-			return false;       //TODO 或许应该继续扩展
-		rule.src_tree_frag.push_back(node);
-		rule.src_node_status.push_back(-2);
-		rule.src_node_span.push_back(node->tgt_span);
-		for (const auto child : node->children)
+		else if (type == 1 && out_of_span)   											//超过了源端span的边界节点
 		{
-			bool flag = find_syntax_phrase_frag(child,rule,src_span);
-			if (flag == false)
-				return false;
+			rule.src_node_status.push_back(rule.variable_num);
+			rule.src_node_span.push_back(tgt_span);
+			for (int tgt_idx=tgt_span.first;tgt_idx<=tgt_span.second;tgt_idx++)
+			{
+				rule.tgt_word_status.at(tgt_idx) = rule.variable_num;					//根据当前节点的tgt_span更新目标端单词的状态
+			}
+			rule.variable_num++;
+		}
+		else 																			//非边界节点或源端span内的边界节点，继续扫描其孩子
+		{
+			if (type == 2 && out_of_span)  											//超过了源端span的非边界节点
+				return false;       //TODO 或许应该继续扩展
+			rule.src_node_status.push_back(-2);
+			rule.src_node_span.push_back(tgt_span);
+			cur++;
+			continue;
 		}
+		cur = tspair->node_subtree_ends.at(cur);
 	}
 	return true;
 }
 
 pair<int,int> RuleExtractor::cal_src_span_for_tgt_span(pair<int,int> tgt_span)
 {
-	int src_lbound = -1;
-	int src_rbound = -1;
-	for (int i=tgt_span.first;i<=tgt_span.second;i++)
-	{
-		if (tspair->tgt_idx_to_src_span.at(i).first == -1)
-			continue;
-		if (src_lbound == -1 || src_lbound > tspair->tgt_idx_to_src_span.at(i).first)
-		{
-			src_lbound = tspair->tgt_idx_to_src_span.at(i).first;
-		}
-		if (src_rbound == -1 || src_rbound < tspair->tgt_idx_to_src_span.at(i).second)
-		{
-			src_rbound = tspair->tgt_idx_to_src_span.at(i).second;
-		}
-	}
+	int src_lbound = tspair->tgt_to_src_lbound_table.query(tgt_span.first,tgt_span.second);
+	if (src_lbound == INT_MAX)												//目标端span内的单词全都对空
+		return make_pair(-1,-1);
+	int src_rbound = tspair->tgt_to_src_rbound_table.query(tgt_span.first,tgt_span.second);
 	return make_pair(src_lbound,src_rbound);
 }
 
 bool RuleExtractor::check_alignment_for_src_span(pair<int,int> src_span,pair<int,int> tgt_span)
 {
-	for (int j=src_span.first;j<=src_span.second;j++)
+	int tgt_lbound = tspair->src_to_tgt_lbound_table.query(src_span.first,src_span.second);
+	int tgt_rbound = tspair->src_to_tgt_rbound_table.query(src_span.first,src_span.second);
+	if (tgt_rbound == -1)													//源端span内的单词全都对空
+		return true;
+	return tgt_lbound >= tgt_span.first && tgt_rbound <= tgt_span.second;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 抽取所有节点的组合规则
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 按先序顺序抽取每个边界节点的组合规则，多棵句法树共享的节点只抽取一次
+************************************************************************************* */
+void RuleExtractor::extract_compose_rules()
+{
+	for (int node=0;node<tspair->node_num();node++)
 	{
-		for (int tgt_idx : tspair->src_idx_to_tgt_idx.at(j))
+		if (tspair->node_types.at(node) == 1 && tspair->node_canonical.at(node) == node)
 		{
-			if (tgt_idx < tgt_span.first || tgt_idx > tgt_span.second)
-				return false;
+			vector<Rule> new_rules;
+			compose_rules_for_node(node,new_rules);
+			vector<Rule> &rules = tspair->node_rules.at(node);
+			rules.insert(rules.end(),new_rules.begin(),new_rules.end());
 		}
 	}
-	return true;
+	vector<NodeDerivations>().swap(node_derivations);
 }
 
 /**************************************************************************************
- 1. 函数功能: 抽取当前子树包含的组合规则
- 2. 入口参数: 当前子树的根节点
- 3. 出口参数: 无
- 4. 算法简介: 先序遍历当前子树，抽取每个每个节点的组合规则
+ 1. 函数功能: 计算当前边界节点的组合规则，放入new_rules中
+ 2. 入口参数: 当前边界节点
+ 3. 出口参数: 存放组合规则的new_rules
+ 4. 算法简介: 只读取当前节点及其子孙节点已有的规则，不修改任何节点，因此不同节点
+ 			  可以同时计算
 ************************************************************************************* */
-void RuleExtractor::extract_compose_rules(SyntaxNode* node)
+void RuleExtractor::compose_rules_for_node(int node,vector<Rule> &new_rules)
 {
-	if (node->type == 1)
+	if (dp_compose)
 	{
-		vector<Rule>* rules_to_be_composed = &node->rules;
-		vector<Rule>* composed_rules = new vector<Rule>;
-		vector<vector<Rule>* > rules_to_be_deleted = {composed_rules};
-		for (int compose_num=1;compose_num<MAX_RULE_SIZE;compose_num++)	 //一个组合规则最多由MAX_RULE_SIZE个最小规则(或者最多一个SPMT规则)组合而成
+		compose_rules_for_node_by_dp(node,new_rules);
+		return;
+	}
+	long long avoided_num = 0;
+	vector<Rule>* rules_to_be_composed = &tspair->node_rules.at(node);
+	vector<Rule>* composed_rules = new vector<Rule>;
+	vector<vector<Rule>* > rules_to_be_deleted = {composed_rules};
+	for (int compose_num=1;compose_num<max_rule_size;compose_num++)		 //一个组合规则最多由max_rule_size个最小规则(或者最多一个SPMT规则)组合而成
+	{
+		for (auto &rule : *rules_to_be_composed)
 		{
-			for (auto &rule : *rules_to_be_composed)
-			{
-				expand_rule(rule,composed_rules);						 //对待扩展规则进行扩展
-			}
-			if (composed_rules->empty())								 //待扩展规则不包含变量节点，无法继续扩展
-				break;
-			node->rules.insert(node->rules.end(),composed_rules->begin(),composed_rules->end());
-			rules_to_be_composed = composed_rules;						 //将新生成的规则作为下一次的待扩展规则
-			composed_rules = new vector<Rule>;
-			rules_to_be_deleted.push_back(composed_rules);
+			expand_rule(rule,composed_rules,avoided_num);				 //对待扩展规则进行扩展
 		}
-		for (auto p_rules : rules_to_be_deleted)
+		if (composed_rules->empty())									 //待扩展规则不包含变量节点，无法继续扩展
+			break;
+		new_rules.insert(new_rules.end(),composed_rules->begin(),composed_rules->end());
+		rules_to_be_composed = composed_rules;							 //将新生成的规则作为下一次的待扩展规则
+		composed_rules = new vector<Rule>;
+		rules_to_be_deleted.push_back(composed_rules);
+	}
+	for (auto p_rules : rules_to_be_deleted)
+	{
+		delete p_rules;													 //删除所有扩张的规则，否则会内存泄露
+	}
+#pragma omp atomic
+	avoided_duplicate_num += avoided_num;
+}
+
+// 检查规则中是否有两个变量的目标端span相交
+static bool variables_overlap(Rule &rule)
+{
+	vector<pair<int,int> > spans;
+	for (int i=1;i<rule.src_tree_frag.size();i++)
+	{
+		if (rule.src_node_status.at(i) >= 0)
 		{
-			delete p_rules;												 //删除所有扩张的规则，否则会内存泄露
+			spans.push_back(rule.src_node_span.at(i));
 		}
 	}
-	for (auto child : node->children)
+	sort(spans.begin(),spans.end());
+	for (int k=1;k<spans.size();k++)
 	{
-		extract_compose_rules(child);
+		if (spans.at(k).first <= spans.at(k-1).second)
+			return true;
 	}
+	return false;
 }
 
 /**************************************************************************************
  1. 函数功能: 对当前规则进行扩展，将生成的规则放入composed_rules中
  2. 入口参数: 当前规则的引用
- 3. 出口参数: 存放新生成规则的composed_rules
- 4. 算法简介: 对当前规则的每一个变量节点，使用该节点的最小规则对其进行替换
+ 3. 出口参数: 存放新生成规则的composed_rules，累加没有重复生成的规则数avoided_num
+ 4. 算法简介: 对当前规则的每一个变量节点，使用该节点的最小规则对其进行替换。
+ 			  同一组合规则可以按不同的顺序替换得到，因此只替换上一次替换位置之后的
+			  变量，每条组合规则只生成一次。变量span相交时替换顺序会改变目标端单词的
+			  状态，此时不限制顺序，以免漏掉规则
 ************************************************************************************* */
-void RuleExtractor::expand_rule(Rule &rule,vector<Rule>* composed_rules)
+void RuleExtractor::expand_rule(Rule &rule,vector<Rule>* composed_rules,long long &avoided_num)
 {
+	bool order_sensitive = rule.type == 4? rule.order_sensitive : variables_overlap(rule);
 	int variable_idx = -1;													//表示当前节点是规则中第几个变量节点
 	for (int node_idx=0;node_idx<rule.src_tree_frag.size();node_idx++)		//遍历规则源端的每个节点
 	{
 		if (rule.src_node_status.at(node_idx) < 0)							//跳过非变量节点，只对变量节点进行扩展生成新规则
 			continue;
 		variable_idx++;
-		for (auto &sub_rule : rule.src_tree_frag.at(node_idx)->rules)		//遍历该变量节点的所有规则
+		int variable_node = tspair->node_canonical.at(rule.src_tree_frag.at(node_idx));
+		for (auto &sub_rule : tspair->node_rules.at(variable_node))		//遍历该变量节点（的代表节点）的所有规则
 		{
 			if (sub_rule.type > 2)											//跳过SPMT规则和组合规则，只使用最小规则来替换当前变量节点
 				continue;
@@ -387,6 +609,11 @@ void RuleExtractor::expand_rule(Rule &rule,vector<Rule>* composed_rules)
 			*/
 			if (sub_rule.src_node_span.front() != rule.src_node_span.at(node_idx))
 				continue;													//如果最小规则的目标端span与变量节点的不同，则跳过
+			if (node_idx < rule.last_expanded_idx && !order_sensitive && !variables_overlap(sub_rule))
+			{
+				avoided_num++;												//按规范顺序会在更早的一轮生成
+				continue;
+			}
 			generate_new_rule(rule,node_idx,variable_idx,sub_rule,composed_rules);
 		}
 	}
@@ -405,6 +632,8 @@ void RuleExtractor::generate_new_rule(Rule &rule,int node_idx,int variable_idx,R
 	new_rule.variable_num = rule.variable_num + sub_rule.variable_num - 1;
 	new_rule.type = 4;
 	new_rule.size = rule.size + 1;
+	new_rule.last_expanded_idx = node_idx;
+	new_rule.order_sensitive = (rule.type == 4? rule.order_sensitive : variables_overlap(rule)) || variables_overlap(sub_rule);
 	//生成新规则的源端句法节点序列
 	new_rule.src_tree_frag.assign(rule.src_tree_frag.begin(),rule.src_tree_frag.begin()+node_idx);
 	new_rule.src_tree_frag.insert(new_rule.src_tree_frag.end(),sub_rule.src_tree_frag.begin(),sub_rule.src_tree_frag.end());
@@ -458,8 +687,294 @@ void RuleExtractor::generate_new_rule(Rule &rule,int node_idx,int variable_idx,R
 		}
 	}
 	cal_tgt_word_num(new_rule);
-	if (new_rule.tgt_word_num <= MAX_RHS_WORD_NUM && new_rule.src_tree_frag.size() <= MAX_LHS_NODE_NUM)
+	if (new_rule.tgt_word_num <= MAX_RHS_WORD_NUM && new_rule.src_tree_frag.size() <= max_lhs_node_num)
 	{
 		composed_rules->push_back(new_rule);
 	}
 }
+
+// 统计规则目标端span内未被变量覆盖的单词数，记录变量的位置，并检查各变量的span是否互不相交
+static void analyze_variables(Rule &rule,vector<int> &variable_positions,int &free_word_num,bool &disjoint)
+{
+	free_word_num = 0;
+	for (int j=rule.src_node_span.front().first;j<=rule.src_node_span.front().second;j++)
+	{
+		if (rule.tgt_word_status.at(j) == -1)
+		{
+			free_word_num++;
+		}
+	}
+	for (int i=1;i<rule.src_tree_frag.size();i++)
+	{
+		if (rule.src_node_status.at(i) >= 0)
+		{
+			variable_positions.push_back(i);
+		}
+	}
+	disjoint = !variables_overlap(rule);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 计算当前边界节点上以最小规则为根、大小小于max_rule_size的所有推导
+ 2. 入口参数: 当前边界节点（代表节点）
+ 3. 出口参数: 无
+ 4. 算法简介: 先递归计算所有变量节点的推导，再为每条最小规则的每个变量选择保留
+ 			  或者替换为孩子节点上span相同的推导；推导只记录选择，不复制规则，
+			  按大小排序后存放。源端节点数随组合单调增加，超过上限的推导直接丢弃
+************************************************************************************* */
+void RuleExtractor::build_derivations(int node)
+{
+	if (node_derivations.empty())
+	{
+		node_derivations.resize(tspair->node_num());
+		derivations_built.assign(tspair->node_num(),0);
+	}
+	if (derivations_built.at(node))
+		return;
+	derivations_built.at(node) = 1;
+	vector<Rule> &rules = tspair->node_rules.at(node);
+	for (auto &rule : rules)
+	{
+		if (rule.type > 2)
+			continue;
+		for (int i=1;i<rule.src_tree_frag.size();i++)
+		{
+			if (rule.src_node_status.at(i) >= 0)
+			{
+				build_derivations(tspair->node_canonical.at(rule.src_tree_frag.at(i)));
+			}
+		}
+	}
+	vector<Derivation> derivations;
+	vector<int> child_choices;
+	for (int rule_idx=0;rule_idx<rules.size();rule_idx++)
+	{
+		Rule &rule = rules.at(rule_idx);
+		if (rule.type > 2)
+			continue;
+		vector<int> variable_positions;
+		int free_word_num;
+		bool disjoint;
+		analyze_variables(rule,variable_positions,free_word_num,disjoint);
+		vector<int> choices(variable_positions.size(),-1);
+		choose_children(rule,variable_positions,0,choices,1,rule.src_tree_frag.size(),free_word_num,disjoint,disjoint,false,
+						[&](int size,int lhs_node_num,int tgt_word_num,bool all_disjoint){
+			if (size > 1 && size >= max_rule_size)								//作为孩子推导时根节点上至少还有一个规则
+				return;
+			derivations.push_back({rule_idx,size,lhs_node_num,tgt_word_num,all_disjoint,(int)child_choices.size()});
+			child_choices.insert(child_choices.end(),choices.begin(),choices.end());
+		});
+	}
+	NodeDerivations &result = node_derivations.at(node);
+	result.size_ends.assign(max_rule_size,0);
+	for (int size=1;size<=max_rule_size;size++)
+	{
+		for (auto &derivation : derivations)
+		{
+			if (derivation.size != size)
+				continue;
+			int variable_num = rules.at(derivation.rule_idx).variable_num;
+			result.derivations.push_back(derivation);
+			result.derivations.back().choice_offset = result.child_choices.size();
+			result.child_choices.insert(result.child_choices.end(),child_choices.begin()+derivation.choice_offset,child_choices.begin()+derivation.choice_offset+variable_num);
+		}
+		result.size_ends.at(size-1) = result.derivations.size();
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 依次为规则的每个变量选择保留或者替换为孩子节点的推导，每得到一种完整的
+ 			  选择就调用emit
+ 2. 入口参数: 规则，变量在规则中的位置，当前变量，各变量的选择，已使用的大小，源端节点数，
+ 			  目标端单词数的下界，规则的变量span是否互不相交，已选择的推导是否都
+			  互不相交，是否按目标端单词数剪枝
+ 3. 出口参数: 无
+ 4. 算法简介: 孩子推导按大小排序，剩余的大小不足时停止；源端节点数超过上限时剪枝。
+ 			  变量span相交时替换顺序会改变目标端单词的状态，因此只有规则的变量span
+			  互不相交时才累加孩子推导的单词数；单词数的下界只对最终的规则有效，
+			  只在以当前节点为根组合时用来剪枝（规则的单词数不含span的最后一个单词，因此减一）
+************************************************************************************* */
+void RuleExtractor::choose_children(Rule &rule,vector<int> &variable_positions,int variable_idx,vector<int> &choices,int size,int lhs_node_num,int tgt_word_num,
+									bool disjoint,bool all_disjoint,bool prune_by_words,const function<void(int,int,int,bool)> &emit)
+{
+	if (variable_idx == variable_positions.size())
+	{
+		emit(size,lhs_node_num,tgt_word_num,all_disjoint);
+		return;
+	}
+	choices.at(variable_idx) = -1;
+	choose_children(rule,variable_positions,variable_idx+1,choices,size,lhs_node_num,tgt_word_num,disjoint,all_disjoint,prune_by_words,emit);
+	if (size >= max_rule_size)
+		return;
+	int position = variable_positions.at(variable_idx);
+	int child_node = tspair->node_canonical.at(rule.src_tree_frag.at(position));
+	NodeDerivations &child = node_derivations.at(child_node);
+	int end = child.size_ends.at(max_rule_size-size-1);
+	for (int i=0;i<end;i++)
+	{
+		Derivation &derivation = child.derivations.at(i);
+		if (tspair->node_rules.at(child_node).at(derivation.rule_idx).src_node_span.front() != rule.src_node_span.at(position))
+			continue;													//孩子推导的目标端span必须与变量节点的相同
+		int new_lhs_node_num = lhs_node_num+derivation.lhs_node_num-1;
+		int new_tgt_word_num = disjoint? tgt_word_num+derivation.min_tgt_word_num : tgt_word_num;
+		if (new_lhs_node_num > max_lhs_node_num || (prune_by_words && new_tgt_word_num-1 > MAX_RHS_WORD_NUM))
+			continue;
+		choices.at(variable_idx) = i;
+		choose_children(rule,variable_positions,variable_idx+1,choices,size+derivation.size,new_lhs_node_num,new_tgt_word_num,
+						disjoint,all_disjoint && derivation.disjoint,prune_by_words,emit);
+	}
+	choices.at(variable_idx) = -1;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 用动态规划计算当前边界节点的组合规则，放入new_rules中
+ 2. 入口参数: 当前边界节点
+ 3. 出口参数: 存放组合规则的new_rules
+ 4. 算法简介: 以节点上的每条最小规则或SPMT规则为根，为其变量选择孩子节点的推导，
+ 			  至少替换一个变量且总大小不超过max_rule_size。推导中各规则的变量span
+			  互不相交时，替换顺序不影响结果，直接生成一次；否则按所有可能的顺序
+			  依次替换，与逐轮扩展得到的规则集合相同
+************************************************************************************* */
+void RuleExtractor::compose_rules_for_node_by_dp(int node,vector<Rule> &new_rules)
+{
+	build_derivations(node);
+	vector<Rule> &rules = tspair->node_rules.at(node);
+	for (int rule_idx=0;rule_idx<rules.size();rule_idx++)
+	{
+		Rule &rule = rules.at(rule_idx);
+		if (rule.type > 3)
+			continue;
+		vector<int> variable_positions;
+		int free_word_num;
+		bool disjoint;
+		analyze_variables(rule,variable_positions,free_word_num,disjoint);
+		vector<int> choices(variable_positions.size(),-1);
+		choose_children(rule,variable_positions,0,choices,1,rule.src_tree_frag.size(),free_word_num,disjoint,disjoint,true,
+						[&](int size,int lhs_node_num,int tgt_word_num,bool all_disjoint){
+			if (size == 1)
+				return;
+			if (!all_disjoint)
+			{
+				vector<PendingSubstitution> pending;
+				for (int k=0;k<variable_positions.size();k++)
+				{
+					if (choices.at(k) != -1)
+					{
+						int variable_node = rule.src_tree_frag.at(variable_positions.at(k));
+						pending.push_back({variable_node,tspair->node_canonical.at(variable_node),choices.at(k)});
+					}
+				}
+				substitute_in_all_orders(rule,pending,new_rules);
+				return;
+			}
+			Rule new_rule;
+			new_rule.size = size;
+			materialize_derivation(node,rule_idx,choices.data(),new_rule);
+			cal_tgt_word_num(new_rule);
+			if (new_rule.tgt_word_num <= MAX_RHS_WORD_NUM && new_rule.src_tree_frag.size() <= max_lhs_node_num)
+			{
+				new_rules.push_back(new_rule);
+			}
+		});
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 根据根规则和各变量的选择生成完整的组合规则
+ 2. 入口参数: 根节点，根规则的位置，各变量的选择
+ 3. 出口参数: 组合规则
+ 4. 算法简介: 先序遍历根规则的节点，被替换的变量递归展开为孩子推导；孩子推导的根节点
+ 			  变为内部节点，其span内的目标端单词先置为-1，再由其变量覆盖。
+			  推导中各规则的变量span互不相交时，与用generate_new_rule逐个替换的结果相同
+************************************************************************************* */
+void RuleExtractor::materialize_derivation(int node,int rule_idx,const int *choices,Rule &new_rule)
+{
+	Rule &rule = tspair->node_rules.at(node).at(rule_idx);
+	new_rule.src_tree_frag.push_back(rule.src_tree_frag.front());
+	new_rule.src_node_span.push_back(rule.src_node_span.front());
+	if (new_rule.src_tree_frag.size() == 1)									//组合规则的根节点
+	{
+		new_rule.type = 4;
+		new_rule.tgt_word_status = rule.tgt_word_status;
+		new_rule.src_node_status.push_back(-1);
+	}
+	else
+	{
+		new_rule.src_node_status.push_back(-2);
+		for (int j=rule.src_node_span.front().first;j<=rule.src_node_span.front().second;j++)
+		{
+			new_rule.tgt_word_status.at(j) = -1;
+		}
+	}
+	for (int i=1;i<rule.src_tree_frag.size();i++)
+	{
+		int status = rule.src_node_status.at(i);
+		if (status >= 0 && choices[status] != -1)
+		{
+			int child_node = tspair->node_canonical.at(rule.src_tree_frag.at(i));
+			NodeDerivations &child = node_derivations.at(child_node);
+			Derivation &derivation = child.derivations.at(choices[status]);
+			materialize_derivation(child_node,derivation.rule_idx,child.child_choices.data()+derivation.choice_offset,new_rule);
+			continue;
+		}
+		new_rule.src_tree_frag.push_back(rule.src_tree_frag.at(i));
+		new_rule.src_node_span.push_back(rule.src_node_span.at(i));
+		if (status >= 0)
+		{
+			new_rule.src_node_status.push_back(new_rule.variable_num);
+			for (int j=rule.src_node_span.at(i).first;j<=rule.src_node_span.at(i).second;j++)
+			{
+				new_rule.tgt_word_status.at(j) = new_rule.variable_num;
+			}
+			new_rule.variable_num++;
+		}
+		else
+		{
+			new_rule.src_node_status.push_back(status);
+		}
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 按所有可能的顺序完成剩余的替换，用于变量span相交的推导
+ 2. 入口参数: 当前规则，尚未完成的替换
+ 3. 出口参数: 存放组合规则的new_rules
+ 4. 算法简介: 每次选择一个尚未完成的替换，用generate_new_rule生成新规则后递归，
+ 			  被替换的孩子推导中的替换随后加入；中间规则超过上限时与逐轮扩展一样丢弃
+************************************************************************************* */
+void RuleExtractor::substitute_in_all_orders(Rule &rule,vector<PendingSubstitution> &pending,vector<Rule> &new_rules)
+{
+	if (pending.empty())
+	{
+		new_rules.push_back(rule);
+		return;
+	}
+	for (int k=0;k<pending.size();k++)
+	{
+		PendingSubstitution substitution = pending.at(k);
+		int node_idx = 1;
+		while (rule.src_tree_frag.at(node_idx) != substitution.variable_node || rule.src_node_status.at(node_idx) < 0)
+		{
+			node_idx++;
+		}
+		NodeDerivations &child = node_derivations.at(substitution.child_node);
+		Derivation &derivation = child.derivations.at(substitution.derivation_idx);
+		Rule &sub_rule = tspair->node_rules.at(substitution.child_node).at(derivation.rule_idx);
+		vector<Rule> composed_rules;
+		generate_new_rule(rule,node_idx,rule.src_node_status.at(node_idx),sub_rule,&composed_rules);
+		if (composed_rules.empty())
+			continue;
+		vector<PendingSubstitution> rest = pending;
+		rest.erase(rest.begin()+k);
+		for (int i=1;i<sub_rule.src_tree_frag.size();i++)
+		{
+			int status = sub_rule.src_node_status.at(i);
+			if (status >= 0 && child.child_choices.at(derivation.choice_offset+status) != -1)
+			{
+				int variable_node = sub_rule.src_tree_frag.at(i);
+				rest.push_back({variable_node,tspair->node_canonical.at(variable_node),child.child_choices.at(derivation.choice_offset+status)});
+			}
+		}
+		substitute_in_all_orders(composed_rules.front(),rest,new_rules);
+	}
+}
@@ -4,32 +4,117 @@
 #include "myutils.h"
 #include "tree_str_pair.h"
 #include "rule_counter.h"
+#include "instance_sink.h"
+#include "counter_update_buffer.h"
+
+// 一个组合推导：节点上的一条最小规则，以及它的每个变量选择的孩子节点推导，只在输出时才生成完整的规则
+struct Derivation
+{
+	int rule_idx;													//根规则在节点规则列表中的位置
+	int size;														//由几个最小规则组成
+	int lhs_node_num;												//生成的规则源端的节点数
+	int min_tgt_word_num;											//目标端span内（含右端点）不被变量覆盖的单词数的下界
+	bool disjoint;													//推导中每条规则的变量span都互不相交，此时替换顺序不影响结果
+	int choice_offset;												//每个变量的选择在child_choices中的起始位置
+};
+
+// 推导中尚未完成的一次替换
+struct PendingSubstitution
+{
+	int variable_node;												//被替换的变量节点
+	int child_node;													//变量节点的代表节点
+	int derivation_idx;												//代表节点上用来替换的推导
+};
+
+// 一个边界节点上按大小排序的所有推导
+struct NodeDerivations
+{
+	vector<Derivation> derivations;
+	vector<int> size_ends;											//size_ends[k]为大小不超过k+1的推导个数
+	vector<int> child_choices;										//-1表示保留该变量，否则为孩子节点的推导编号
+};
+
+// 抽取规则的设置，命令行程序、抽取服务和BatchExtractor共用
+struct ExtractionOptions
+{
+	int max_rule_size;												//组合规则最多由几个最小规则组成
+	int max_lhs_node_num;											//规则左端最多有几个节点
+	bool dp_compose;												//用动态规划代替逐轮扩展来生成组合规则
+	bool kbest_input;												//每个句子有多棵句法树，每行形如"权重 ||| 句法树"
+	bool log_tree_weights;											//k-best句法树的权重是对数概率
+	ExtractionOptions()
+	{
+		max_rule_size = MAX_RULE_SIZE;
+		max_lhs_node_num = MAX_LHS_NODE_NUM;
+		dp_compose = false;
+		kbest_input = false;
+		log_tree_weights = false;
+	}
+};
 
 class RuleExtractor
 {
 	public:
-		RuleExtractor(string &line_tree,string &line_str,string &line_align,map<string,double> *lex_s2t,map<string,double> *lex_t2s,RuleCounter *counter);
+		RuleExtractor(string &line_tree,string &line_str,string &line_align,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s);
+		RuleExtractor(vector<string> &lines_tree,vector<double> &tree_weights,string &line_str,string &line_align,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s);
+		RuleExtractor(ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,const map<string,double> *lex_s2t,const map<string,double> *lex_t2s);
 		~RuleExtractor()
 		{
 			delete tspair;
 		}
+		void set_options(const ExtractionOptions &options);
 		void extract_rules();
+		void count_rules(RuleCounter *counter);
+		void count_rules(CounterUpdateBuffer *buffer);
+		void write_instances(InstanceSink *sink,int worker_id);
+		void take_rule_records(vector<RuleRecord> &records);
+		double estimate_cost();
+		size_t memory_size();
+		long long get_avoided_duplicate_num()
+		{
+			return avoided_duplicate_num;
+		}
+		long long get_rule_num()										// 抽取到的规则实例数
+		{
+			return rule_records.size();
+		}
+
+	public:
+		int multiplicity;												//当前句子在语料中重复出现的次数，只抽取一次
+		long long sentence_id;											//当前句子在语料中的编号，从0开始
+		int max_rule_size;												//组合规则最多由几个最小规则组成，默认为MAX_RULE_SIZE，内存紧张时调小
+		int max_lhs_node_num;											//规则左端最多有几个节点，默认为MAX_LHS_NODE_NUM
+		bool dp_compose;												//用自底向上的动态规划代替逐轮扩展来生成组合规则
 
 	private:
-		void extract_GHKM_rules(SyntaxNode* node);
-		void find_frontier_frag(SyntaxNode* node,Rule &rule);
-		void attach_unaligned_words(SyntaxNode* node);
+		void extract_rules_in_parallel();
+		void extract_GHKM_rules();
+		void extract_minimal_rules_for_node(int node);
+		void find_frontier_frag(int node,Rule &rule);
+		void attach_unaligned_words(int node);
 		void cal_tgt_word_num(Rule &rule);
 		void extract_SPMT_rules();
-		bool find_syntax_phrase_frag(SyntaxNode* node,Rule &rule,pair<int,int> src_span);
+		void extract_SPMT_rules_in_tree();
+		bool find_syntax_phrase_frag(int node,Rule &rule,pair<int,int> src_span);
 		pair<int,int> cal_src_span_for_tgt_span(pair<int,int> tgt_span);
 		bool check_alignment_for_src_span(pair<int,int> src_span,pair<int,int> tgt_span);
-		void extract_compose_rules(SyntaxNode* node);
-		void expand_rule(Rule &rule,vector<Rule>* composed_rules);
+		void extract_compose_rules();
+		void compose_rules_for_node(int node,vector<Rule> &new_rules);
+		void expand_rule(Rule &rule,vector<Rule>* composed_rules,long long &avoided_num);
 		void generate_new_rule(Rule &rule,int node_idx,int variable_idx,Rule &sub_rule,vector<Rule>* composed_rules);
+		void build_derivations(int node);
+		void compose_rules_for_node_by_dp(int node,vector<Rule> &new_rules);
+		void choose_children(Rule &rule,vector<int> &variable_positions,int variable_idx,vector<int> &choices,int size,int lhs_node_num,int tgt_word_num,
+							 bool disjoint,bool all_disjoint,bool prune_by_words,const function<void(int,int,int,bool)> &emit);
+		void materialize_derivation(int node,int rule_idx,const int *choices,Rule &new_rule);
+		void substitute_in_all_orders(Rule &rule,vector<PendingSubstitution> &pending,vector<Rule> &new_rules);
 
 	private:
 		TreeStrPair *tspair;
+		vector<RuleRecord> rule_records;								//抽取到的所有规则的字符串形式，每个节点上的规则不重复
+		long long avoided_duplicate_num;								//按规范顺序扩展时没有重复生成的组合规则数
+		vector<NodeDerivations> node_derivations;						//动态规划组合时每个代表节点的推导，用完即释放
+		vector<char> derivations_built;
 };
 
 #endif
@@ -0,0 +1,179 @@
+#include "rule_table_estimator.h"
+
+RuleTableEstimator::RuleTableEstimator(LexTable *lex_table,int thread_num,const string &counter_type,int sample_size,bool dedup)
+{
+	this->lex_table = lex_table;
+	this->thread_num = thread_num;
+	this->counter_type = counter_type;
+	this->sample_size = sample_size;
+	this->dedup = dedup;
+	sentence_num = 0;
+	rng_state = 0x853c49e6748fea9bULL;									// 固定种子，使同一语料的估计结果可以复现
+	instance_num = 0;
+	sample_rule_num = 0;
+	extract_seconds = 0;
+	counter_bytes_per_rule = 0;
+	output_bytes_per_rule = 0;
+}
+
+// splitmix64随机数
+static unsigned long long next_random(unsigned long long &state)
+{
+	unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+	z = (z^(z>>30))*0xbf58476d1ce4e5b9ULL;
+	z = (z^(z>>27))*0x94d049bb133111ebULL;
+	return z^(z>>31);
+}
+
+// 蓄水池抽样：第t个句子（从1开始）以sample_size/t的概率进入样本，替换样本中随机的一个；
+// 每个句子的指纹都加入HyperLogLog，用于估计不同句子的比例
+void RuleTableEstimator::offer(SampledSentence &sentence)
+{
+	sentence_num++;
+	string key;
+	for (int i=0;i<sentence.lines_tree.size();i++)
+	{
+		key += to_string(sentence.tree_weights.at(i))+" ||| "+sentence.lines_tree.at(i)+"\n";
+	}
+	key += sentence.line_str+"\n"+sentence.line_align;
+	sentence_hll.add(fingerprint_128(key.data(),key.size()).hi);
+	if (samples.size() < sample_size)
+	{
+		samples.push_back(sentence);
+		return;
+	}
+	unsigned long long pos = next_random(rng_state)%sentence_num;
+	if (pos < sample_size)
+	{
+		swap(samples.at(pos),sentence);
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 对样本抽取规则并统计
+ 2. 入口参数: 组合规则的大小上限，规则左端的节点数上限，是否用动态规划组合，是否为k-best输入
+ 3. 出口参数: 无
+ 4. 算法简介: 1) 与正式抽取一样并行抽取并计入各线程的计数器，记录耗时
+ 			  2) 按样本顺序把每条规则的指纹加入HyperLogLog，在样本的1/8、1/4、1/2及
+			     末尾记录不同规则数，用于拟合Heaps定律
+			  3) 合并计数器，得到每条不同规则平均占用的计数器内存和输出字节数
+************************************************************************************* */
+void RuleTableEstimator::estimate(int max_rule_size,int max_lhs_node_num,bool dp_compose,bool kbest_input)
+{
+	double start_time = omp_get_wtime();
+	vector<RuleExtractor*> extractors(samples.size());
+#pragma omp parallel for schedule(dynamic) num_threads(thread_num)
+	for (int i=0;i<samples.size();i++)
+	{
+		SampledSentence &sample = samples.at(i);
+		if (kbest_input)
+		{
+			extractors.at(i) = new RuleExtractor(sample.lines_tree,sample.tree_weights,sample.line_str,sample.line_align,&lex_table->lex_s2t,&lex_table->lex_t2s);
+		}
+		else
+		{
+			extractors.at(i) = new RuleExtractor(sample.lines_tree.at(0),sample.line_str,sample.line_align,&lex_table->lex_s2t,&lex_table->lex_t2s);
+		}
+		extractors.at(i)->max_rule_size = max_rule_size;
+		extractors.at(i)->max_lhs_node_num = max_lhs_node_num;
+		extractors.at(i)->dp_compose = dp_compose;
+	}
+	vector<RuleCounter*> counters;
+	for (int i=0;i<thread_num;i++)
+	{
+		counters.push_back(create_rule_counter(counter_type));
+	}
+	vector<vector<RuleRecord> > records(samples.size());
+	SentenceScheduler scheduler(thread_num);
+	scheduler.run(extractors,counters,&records);
+	extract_seconds = omp_get_wtime()-start_time;
+
+	HyperLogLog hll;
+	int checkpoint = max((int)samples.size()/8,1);
+	for (int i=0;i<records.size();i++)
+	{
+		for (auto &record : records.at(i))
+		{
+			Fingerprint src_fp = fingerprint_128(record.rule_src.data(),record.rule_src.size());
+			Fingerprint tgt_fp = fingerprint_128(record.rule_tgt.data(),record.rule_tgt.size());
+			hll.add(combine_fingerprints(src_fp,tgt_fp).hi);
+		}
+		instance_num += records.at(i).size();
+		if (i+1 == checkpoint || i+1 == records.size())
+		{
+			growth.push_back(make_pair((double)instance_num,hll.estimate()));
+			checkpoint *= 2;
+		}
+	}
+
+	scheduler.merge_counters(counters);
+	vector<ScoredRule> scored_rules;
+	counters.at(0)->collect_rules(scored_rules);
+	sample_rule_num = scored_rules.size();
+	if (sample_rule_num > 0)
+	{
+		counter_bytes_per_rule = (double)counters.at(0)->memory_size()/sample_rule_num;
+		stringstream ss;
+		for (auto &rule : scored_rules)										// 与dump_rules的输出格式相同
+		{
+			ss<<rule.rule_src<<" ||| "<<rule.rule_tgt<<" ||| "<<rule.root2rule_prob<<" "<<rule.trans_prob_t2s<<" "<<rule.trans_prob_s2t<<" "
+			  <<rule.lex_weight_t2s<<" "<<rule.lex_weight_s2t<<endl;
+		}
+		output_bytes_per_rule = (double)ss.str().size()/sample_rule_num;
+	}
+	delete counters.at(0);
+}
+
+// 在对数坐标下对（规则实例数，不同规则数）做最小二乘拟合，斜率即Heaps定律的指数
+double RuleTableEstimator::fit_heaps_exponent()
+{
+	double n = 0,sum_x = 0,sum_y = 0,sum_xx = 0,sum_xy = 0;
+	for (auto &point : growth)
+	{
+		if (point.first <= 0 || point.second <= 0)
+			continue;
+		double x = log(point.first);
+		double y = log(point.second);
+		n++;
+		sum_x += x;
+		sum_y += y;
+		sum_xx += x*x;
+		sum_xy += x*y;
+	}
+	if (n < 2 || n*sum_xx-sum_x*sum_x <= 0)
+		return 1.0;															// 样本太小时保守地假设不同规则数随实例数线性增长
+	double beta = (n*sum_xy-sum_x*sum_y)/(n*sum_xx-sum_x*sum_x);
+	return min(max(beta,0.0),1.0);
+}
+
+void RuleTableEstimator::report()
+{
+	if (samples.empty() || growth.empty())
+	{
+		cout<<"empty corpus\n";
+		return;
+	}
+	double scale = (double)sentence_num/samples.size();
+	double beta = fit_heaps_exponent();
+	double sample_distinct = growth.back().second;
+	double total_distinct = sample_distinct*pow(scale,beta);
+	double distinct_sentence_ratio = dedup? min(sentence_hll.estimate()/sentence_num,1.0) : 1.0;
+	cout.setf(ios::fixed);
+	cout.precision(1);
+	cout<<"sentences: "<<sentence_num<<"\n";
+	cout<<"sampled sentences: "<<samples.size()<<"\n";
+	if (dedup)
+	{
+		cout<<"distinct sentences: "<<distinct_sentence_ratio*sentence_num<<" (HyperLogLog)\n";
+	}
+	cout<<"rules per sentence: "<<(double)instance_num/samples.size()<<"\n";
+	cout<<"distinct rules in sample: "<<sample_rule_num<<" (HyperLogLog "<<sample_distinct<<")\n";
+	cout.precision(3);
+	cout<<"milliseconds per sentence: "<<extract_seconds*1000/samples.size()*thread_num<<" (single thread)\n";
+	cout<<"Heaps exponent: "<<beta<<"\n";
+	cout.precision(1);
+	cout<<"estimated distinct rules: "<<total_distinct<<"\n";
+	cout<<"estimated counter memory: "<<total_distinct*counter_bytes_per_rule/1048576.0<<"M\n";
+	cout<<"estimated output size: "<<total_distinct*output_bytes_per_rule/1048576.0<<"M\n";
+	cout<<"estimated wall time: "<<extract_seconds*scale*distinct_sentence_ratio<<"s with "<<thread_num<<" threads\n";
+}
@@ -0,0 +1,54 @@
+#ifndef RULE_TABLE_ESTIMATOR_H
+#define RULE_TABLE_ESTIMATOR_H
+#include "stdafx.h"
+#include "lex_table.h"
+#include "rule_extractor.h"
+#include "rule_counter.h"
+#include "sentence_scheduler.h"
+#include "hyper_log_log.h"
+
+// 抽样得到的一个句子，1-best输入时只有一棵句法树
+struct SampledSentence
+{
+	vector<string> lines_tree;
+	vector<double> tree_weights;
+	string line_str;
+	string line_align;
+};
+
+/**************************************************************************************
+ 在正式抽取前估计完整语料的规则表大小和运行时间
+ 读入语料时用蓄水池抽样保留均匀的随机样本，只对样本抽取和计数，测量每个句子的规则数和
+ 耗时；不同规则数用HyperLogLog在规则指纹上估计，再按Heaps定律外推到整个语料；
+ 正式抽取时重复的句子只抽取一次，因此运行时间按整个语料中不同句子的比例折算
+************************************************************************************* */
+class RuleTableEstimator
+{
+	public:
+		RuleTableEstimator(LexTable *lex_table,int thread_num,const string &counter_type,int sample_size,bool dedup);
+		void offer(SampledSentence &sentence);
+		void estimate(int max_rule_size,int max_lhs_node_num,bool dp_compose,bool kbest_input);
+		void report();
+
+	private:
+		double fit_heaps_exponent();
+
+	private:
+		LexTable *lex_table;
+		int thread_num;
+		string counter_type;
+		int sample_size;
+		bool dedup;													// 正式抽取时是否只抽取不同的句子
+		long long sentence_num;										// 语料中的句子总数
+		HyperLogLog sentence_hll;									// 估计语料中的不同句子数
+		vector<SampledSentence> samples;
+		unsigned long long rng_state;
+		long long instance_num;										// 样本中的规则实例数
+		long long sample_rule_num;									// 样本中的不同规则数，由计数器精确统计
+		vector<pair<double,double> > growth;						// 样本中（规则实例数，不同规则数的估计值），用于拟合Heaps定律
+		double extract_seconds;
+		double counter_bytes_per_rule;
+		double output_bytes_per_rule;
+};
+
+#endif
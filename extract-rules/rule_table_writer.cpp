@@ -0,0 +1,102 @@
+#include "rule_table_writer.h"
+
+static int output_thread_num = 1;
+
+void set_output_thread_num(int thread_num)
+{
+	output_thread_num = max(thread_num,1);
+}
+
+int get_output_thread_num()
+{
+	return output_thread_num;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 按64位键从小到大排列编号
+ 2. 入口参数: 每个编号的键
+ 3. 出口参数: 排好序的编号，键相同时保持原来的顺序
+ 4. 算法简介: 低位优先的基数排序，每趟处理RADIX_BITS位，高位全为0时提前结束；每个线程
+ 			  负责连续的一段，先各自统计每个桶的个数，再按（桶，线程）的顺序计算写入位置，
+			  使结果与串行排序相同
+************************************************************************************* */
+vector<int> radix_sort_ids(const vector<unsigned long long> &keys)
+{
+	size_t n = keys.size();
+	vector<int> ids(n),next(n);
+	unsigned long long all_bits = 0;
+	for (size_t i=0;i<n;i++)
+	{
+		ids[i] = i;
+		all_bits |= keys[i];
+	}
+	int thread_num = output_thread_num;
+	const int bucket_num = 1<<RADIX_BITS;
+	for (int shift=0;shift<64 && (all_bits>>shift) != 0;shift+=RADIX_BITS)
+	{
+		vector<size_t> positions(thread_num*bucket_num,0);				// 线程t的桶b在positions[t*bucket_num+b]
+#pragma omp parallel for schedule(static,1) num_threads(thread_num)
+		for (int t=0;t<thread_num;t++)
+		{
+			size_t *count = &positions[t*bucket_num];
+			for (size_t i=n*t/thread_num;i<n*(t+1)/thread_num;i++)
+			{
+				count[(keys[ids[i]]>>shift)&(bucket_num-1)]++;
+			}
+		}
+		size_t sum = 0;
+		for (int b=0;b<bucket_num;b++)
+		{
+			for (int t=0;t<thread_num;t++)
+			{
+				size_t count = positions[t*bucket_num+b];
+				positions[t*bucket_num+b] = sum;
+				sum += count;
+			}
+		}
+#pragma omp parallel for schedule(static,1) num_threads(thread_num)
+		for (int t=0;t<thread_num;t++)
+		{
+			size_t *position = &positions[t*bucket_num];
+			for (size_t i=n*t/thread_num;i<n*(t+1)/thread_num;i++)
+			{
+				next[position[(keys[ids[i]]>>shift)&(bucket_num-1)]++] = ids[i];
+			}
+		}
+		ids.swap(next);
+	}
+	return ids;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 按顺序输出规则表
+ 2. 入口参数: 规则数，把第i条规则格式化为一行的函数（会被多个线程同时调用），输出流
+ 3. 出口参数: 无
+ 4. 算法简介: 每次取线程数个连续的块，各线程并行格式化自己的块，再按顺序写出，
+ 			  因此输出与串行逐行输出完全相同，内存中最多保存线程数个块
+************************************************************************************* */
+void write_rule_table(size_t rule_num,const function<void(size_t,ostream&)> &format_rule,ostream &out)
+{
+	int thread_num = output_thread_num;
+	vector<string> chunks(thread_num);
+	for (size_t begin=0;begin<rule_num;begin+=OUTPUT_CHUNK_RULES*thread_num)
+	{
+#pragma omp parallel for schedule(static,1) num_threads(thread_num)
+		for (int t=0;t<thread_num;t++)
+		{
+			size_t lo = min(begin+t*OUTPUT_CHUNK_RULES,rule_num);
+			size_t hi = min(lo+OUTPUT_CHUNK_RULES,rule_num);
+			stringstream ss;
+			for (size_t i=lo;i<hi;i++)
+			{
+				format_rule(i,ss);
+			}
+			chunks[t] = ss.str();
+		}
+		for (auto &chunk : chunks)
+		{
+			out.write(chunk.data(),chunk.size());
+		}
+	}
+	out.flush();
+}
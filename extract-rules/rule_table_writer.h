@@ -0,0 +1,51 @@
+#ifndef RULE_TABLE_WRITER_H
+#define RULE_TABLE_WRITER_H
+#include "stdafx.h"
+
+// 最终规则表的排序和输出阶段，各计数器共用；线程数由set_output_thread_num设置，默认为1
+void set_output_thread_num(int thread_num);
+int get_output_thread_num();
+vector<int> radix_sort_ids(const vector<unsigned long long> &keys);
+void write_rule_table(size_t rule_num,const function<void(size_t,ostream&)> &format_rule,ostream &out);
+
+/**************************************************************************************
+ 1. 函数功能: 并行排序编号
+ 2. 入口参数: 待排序的编号，比较函数
+ 3. 出口参数: 排好序的编号
+ 4. 算法简介: 分成与线程数相同的段各自排序，再逐轮两两归并，每一轮中各对的归并并行进行
+************************************************************************************* */
+template <class Less>
+void parallel_sort_ids(vector<int> &ids,Less less)
+{
+	int chunk_num = get_output_thread_num();
+	if (chunk_num <= 1 || ids.size() < OUTPUT_CHUNK_RULES)
+	{
+		sort(ids.begin(),ids.end(),less);
+		return;
+	}
+	vector<size_t> bounds(chunk_num+1);
+	for (int i=0;i<=chunk_num;i++)
+	{
+		bounds[i] = ids.size()*i/chunk_num;
+	}
+#pragma omp parallel for schedule(static,1) num_threads(chunk_num)
+	for (int i=0;i<chunk_num;i++)
+	{
+		sort(ids.begin()+bounds[i],ids.begin()+bounds[i+1],less);
+	}
+	vector<int> merged(ids.size());
+	for (int width=1;width<chunk_num;width*=2)
+	{
+#pragma omp parallel for schedule(static,1) num_threads(chunk_num)
+		for (int i=0;i<chunk_num;i+=2*width)
+		{
+			size_t lo = bounds[i];
+			size_t mid = bounds[min(i+width,chunk_num)];
+			size_t hi = bounds[min(i+2*width,chunk_num)];
+			merge(ids.begin()+lo,ids.begin()+mid,ids.begin()+mid,ids.begin()+hi,merged.begin()+lo,less);
+		}
+		ids.swap(merged);
+	}
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include "sentence_cache.h"
+
+SentenceCache::SentenceCache(long long max_record_num)
+{
+	this->max_record_num = max_record_num;
+	record_num = 0;
+	bytes = 0;
+	sentence_num = 0;
+	batch_hit_num = 0;
+	cache_hit_num = 0;
+}
+
+vector<RuleRecord>* SentenceCache::find(const string &key)
+{
+	auto it = key2records.find(key);
+	if (it == key2records.end())
+		return NULL;
+	return &it->second;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将一个句子的规则加入缓存
+ 2. 入口参数: 句子的内容，句子的规则（加入后被清空）
+ 3. 出口参数: 无
+ 4. 算法简介: 缓存中的规则总数超过上限时，按插入顺序淘汰最早的句子
+************************************************************************************* */
+void SentenceCache::insert(const string &key,vector<RuleRecord> &records)
+{
+	if (records.size() > max_record_num || key2records.find(key) != key2records.end())
+		return;
+	auto it = key2records.insert(make_pair(key,vector<RuleRecord>())).first;
+	it->second.swap(records);
+	record_num += it->second.size();
+	bytes += key.size()+rule_records_memory_size(it->second);
+	insert_order.push_back(&it->first);
+	evict();
+}
+
+// 按插入顺序淘汰最早的句子，直到规则总数不超过上限
+void SentenceCache::evict()
+{
+	while (record_num > max_record_num)
+	{
+		auto old_it = key2records.find(*insert_order.front());
+		record_num -= old_it->second.size();
+		bytes -= old_it->first.size()+rule_records_memory_size(old_it->second);
+		key2records.erase(old_it);
+		insert_order.pop_front();
+	}
+}
+
+// 内存紧张时将缓存的容量减半
+void SentenceCache::shrink()
+{
+	max_record_num = min(max_record_num,record_num)/2;
+	evict();
+}
+
+void SentenceCache::report()
+{
+	long long hit_num = batch_hit_num + cache_hit_num;
+	cerr<<"dedup: "<<sentence_num<<" sentences, "<<sentence_num-hit_num<<" extracted, "
+		<<batch_hit_num<<" duplicates within batch, "<<cache_hit_num<<" cache hits, hit rate "
+		<<(sentence_num>0? 100.0*hit_num/sentence_num : 0.0)<<"%"<<endl;
+}
@@ -0,0 +1,37 @@
+#ifndef SENTENCE_CACHE_H
+#define SENTENCE_CACHE_H
+#include "stdafx.h"
+#include "rule_counter.h"
+
+// 以句子的内容（句法树，目标端句子，词对齐）为键，缓存最近抽取过的句子的规则；只缓存按完整的
+// 组合规则大小上限抽取的规则，因此内存紧张时调小上限不会使缓存中的句子永久缺少规则
+class SentenceCache
+{
+	public:
+		SentenceCache(long long max_record_num);
+		vector<RuleRecord>* find(const string &key);
+		void insert(const string &key,vector<RuleRecord> &records);
+		void report();
+		void shrink();
+		size_t memory_size()
+		{
+			return bytes;
+		}
+
+	public:
+		long long sentence_num;												// 处理过的句子总数
+		long long batch_hit_num;											// 与同一批中前面的句子重复的句子数
+		long long cache_hit_num;											// 在缓存中找到的句子数
+
+	private:
+		void evict();
+
+	private:
+		unordered_map<string,vector<RuleRecord> > key2records;
+		deque<const string*> insert_order;									// 按插入顺序记录缓存的键，先插入的先被淘汰
+		long long record_num;												// 缓存中的规则总数
+		long long max_record_num;
+		size_t bytes;														// 缓存的键和规则估计占用的内存
+};
+
+#endif
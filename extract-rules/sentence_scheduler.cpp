@@ -0,0 +1,224 @@
+#include "sentence_scheduler.h"
+
+SentenceScheduler::SentenceScheduler(int thread_num)
+{
+	this->thread_num = thread_num;
+	queues.resize(thread_num);
+	for (auto &queue : queues)
+	{
+		omp_init_lock(&queue.lock);
+	}
+	stolen_task_num = 0;
+	avoided_duplicate_num = 0;
+	live_bytes = 0;
+	peak_live_bytes = 0;
+	start_live_bytes = 0;
+	topology = NULL;
+	sink = NULL;
+	batched_counting = false;
+	track_memory = false;
+	update_buffers.resize(thread_num);
+	counted_rule_num = 0;
+	counter_update_num = 0;
+	counting_seconds = 0;
+}
+
+SentenceScheduler::~SentenceScheduler()
+{
+	for (auto &queue : queues)
+	{
+		omp_destroy_lock(&queue.lock);
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 并行抽取一批句子的规则，每个工作线程将规则计入自己的计数器
+ 2. 入口参数: 每个句子的规则抽取器，每个工作线程的计数器，为空时不计数
+ 3. 出口参数: kept_records不为空时，保留每个句子抽取到的规则
+ 4. 算法简介: 1) 按估计代价从大到小排序，轮流分配到各线程的队列中，使代价大的句子
+ 			     最先被处理
+			  2) 每个线程先从自己队列的队首取任务，自己的队列为空时从其他线程
+			     队列的队尾窃取任务，所有队列都为空时结束
+			  3) 处理完的抽取器立即释放
+			  4) 设置了内存上限时，抽取前后统计尚未释放的抽取器占用的内存，记录其峰值；
+			     统计需要遍历每个句子的所有规则，因此不限制内存时不做
+			  5) 批量计数时规则先进入线程的缓冲区，写满或本批结束时才写入计数器
+************************************************************************************* */
+void SentenceScheduler::run(vector<RuleExtractor*> &extractors,vector<RuleCounter*> &counters,vector<vector<RuleRecord> > *kept_records)
+{
+	vector<pair<double,int> > cost_and_ids;
+	live_bytes = 0;
+	for (int i=0;i<extractors.size();i++)
+	{
+		cost_and_ids.push_back(make_pair(extractors.at(i)->estimate_cost(),i));
+		if (track_memory)
+		{
+			live_bytes += extractors.at(i)->memory_size();
+		}
+	}
+	peak_live_bytes = live_bytes;
+	start_live_bytes = live_bytes;
+	sort(cost_and_ids.begin(),cost_and_ids.end(),greater<pair<double,int> >());
+	for (int i=0;i<cost_and_ids.size();i++)
+	{
+		queues.at(i%thread_num).task_ids.push_back(cost_and_ids.at(i).second);
+	}
+#pragma omp parallel num_threads(thread_num)
+	{
+		int worker_id = omp_get_thread_num();
+		if (topology != NULL)
+		{
+			topology->pin_worker(worker_id,thread_num);						// 计数器中的大数组由工作线程首次写入，因此分配在本节点上
+		}
+		int task_id;
+		while (pop_task(worker_id,task_id) || steal_task(worker_id,task_id))
+		{
+			long long bytes_before = track_memory? extractors.at(task_id)->memory_size() : 0;
+			extractors.at(task_id)->extract_rules();
+			long long bytes_after = track_memory? extractors.at(task_id)->memory_size() : 0;
+			if (track_memory)
+			{
+				add_live_bytes(bytes_after-bytes_before);
+			}
+#pragma omp atomic
+			avoided_duplicate_num += extractors.at(task_id)->get_avoided_duplicate_num();
+			if (!counters.empty())
+			{
+				double start_time = omp_get_wtime();
+				long long rule_num = extractors.at(task_id)->get_rule_num();
+				if (batched_counting)
+				{
+					extractors.at(task_id)->count_rules(&update_buffers.at(worker_id));
+					if (update_buffers.at(worker_id).full())
+					{
+						update_buffers.at(worker_id).flush(counters.at(worker_id));
+					}
+				}
+				else
+				{
+					extractors.at(task_id)->count_rules(counters.at(worker_id));
+#pragma omp atomic
+					counter_update_num += rule_num;
+				}
+#pragma omp atomic
+				counted_rule_num += rule_num;
+#pragma omp atomic
+				counting_seconds += omp_get_wtime()-start_time;
+			}
+			if (sink != NULL)
+			{
+				extractors.at(task_id)->write_instances(sink,worker_id);
+			}
+			if (kept_records != NULL)
+			{
+				extractors.at(task_id)->take_rule_records(kept_records->at(task_id));
+			}
+			delete extractors.at(task_id);
+			extractors.at(task_id) = NULL;
+			if (track_memory)
+			{
+				add_live_bytes(-bytes_after);
+			}
+		}
+		if (batched_counting && !counters.empty())							// 本批结束时写入缓冲区中剩余的规则，之后计数器可能被合并或溢出
+		{
+			double start_time = omp_get_wtime();
+			update_buffers.at(worker_id).flush(counters.at(worker_id));
+#pragma omp atomic
+			counting_seconds += omp_get_wtime()-start_time;
+		}
+	}
+	if (batched_counting)
+	{
+		counter_update_num = 0;
+		for (auto &buffer : update_buffers)
+		{
+			counter_update_num += buffer.get_applied_num();
+		}
+	}
+}
+
+void SentenceScheduler::add_live_bytes(long long bytes)
+{
+#pragma omp critical(live_bytes)
+	{
+		live_bytes += bytes;
+		peak_live_bytes = max(peak_live_bytes,live_bytes);
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将所有工作线程的计数器合并到第一个计数器中
+ 2. 入口参数: 每个工作线程的计数器
+ 3. 出口参数: 只剩下合并后的计数器
+ 4. 算法简介: 设置了NUMA拓扑时，先由每个节点的第一个工作线程在本节点内并行合并，
+ 			  得到每个节点一个计数器，再跨节点合并一次；否则依次合并
+************************************************************************************* */
+void SentenceScheduler::merge_counters(vector<RuleCounter*> &counters)
+{
+	if (topology != NULL)
+	{
+#pragma omp parallel num_threads(thread_num)
+		{
+			int worker_id = omp_get_thread_num();
+			topology->pin_worker(worker_id,thread_num);
+			int node = topology->node_of_worker(worker_id,thread_num);
+			if (worker_id == 0 || topology->node_of_worker(worker_id-1,thread_num) != node)	// 本节点的第一个工作线程
+			{
+				for (int i=worker_id+1;i<thread_num && topology->node_of_worker(i,thread_num) == node;i++)
+				{
+					counters.at(worker_id)->merge(*counters.at(i));
+					delete counters.at(i);
+					counters.at(i) = NULL;
+				}
+			}
+		}
+	}
+	for (int i=1;i<counters.size();i++)
+	{
+		if (counters.at(i) == NULL)
+			continue;
+		counters.at(0)->merge(*counters.at(i));
+		delete counters.at(i);
+	}
+	counters.resize(1);
+}
+
+bool SentenceScheduler::pop_task(int worker_id,int &task_id)
+{
+	WorkerQueue &queue = queues.at(worker_id);
+	bool found = false;
+	omp_set_lock(&queue.lock);
+	if (!queue.task_ids.empty())
+	{
+		task_id = queue.task_ids.front();
+		queue.task_ids.pop_front();
+		found = true;
+	}
+	omp_unset_lock(&queue.lock);
+	return found;
+}
+
+bool SentenceScheduler::steal_task(int worker_id,int &task_id)
+{
+	for (int i=1;i<thread_num;i++)												// 依次检查其他线程的队列
+	{
+		WorkerQueue &queue = queues.at((worker_id+i)%thread_num);
+		bool found = false;
+		omp_set_lock(&queue.lock);
+		if (!queue.task_ids.empty())
+		{
+			task_id = queue.task_ids.back();
+			queue.task_ids.pop_back();
+			found = true;
+		}
+		omp_unset_lock(&queue.lock);
+		if (found)
+		{
+#pragma omp atomic
+			stolen_task_num++;
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,91 @@
+#ifndef SENTENCE_SCHEDULER_H
+#define SENTENCE_SCHEDULER_H
+#include "stdafx.h"
+#include "rule_extractor.h"
+#include "rule_counter.h"
+#include "numa_topology.h"
+#include "instance_sink.h"
+
+// 每个工作线程的任务队列，线程从队首取自己的任务，空闲线程从队尾窃取其他线程的任务
+struct WorkerQueue
+{
+	deque<int> task_ids;
+	omp_lock_t lock;
+};
+
+class SentenceScheduler
+{
+	public:
+		SentenceScheduler(int thread_num);
+		~SentenceScheduler();
+		void run(vector<RuleExtractor*> &extractors,vector<RuleCounter*> &counters,vector<vector<RuleRecord> > *kept_records=NULL);
+		void merge_counters(vector<RuleCounter*> &counters);
+		void set_numa_topology(NumaTopology *topology)						// 不为空时每个工作线程绑定到所属的NUMA节点
+		{
+			this->topology = topology;
+		}
+		void set_instance_sink(InstanceSink *sink)							// 不为空时将每个句子的规则实例写入sink
+		{
+			this->sink = sink;
+		}
+		void set_memory_tracking(bool track_memory)						// 为真时统计抽取器占用的内存，供内存上限使用
+		{
+			this->track_memory = track_memory;
+		}
+		void set_batched_counting(bool batched_counting)					// 为真时先缓存多个句子的规则，预聚合后再批量写入计数器
+		{
+			this->batched_counting = batched_counting;
+		}
+		long long get_stolen_task_num()
+		{
+			return stolen_task_num;
+		}
+		long long get_avoided_duplicate_num()								// 组合规则时没有重复生成的规则总数
+		{
+			return avoided_duplicate_num;
+		}
+		long long get_counted_rule_num()									// 计入计数器的规则实例总数
+		{
+			return counted_rule_num;
+		}
+		long long get_counter_update_num()									// 实际写入计数器的次数，批量计数时为预聚合之后的次数
+		{
+			return counter_update_num;
+		}
+		double get_counting_seconds()										// 所有工作线程用于计数的时间之和
+		{
+			return counting_seconds;
+		}
+		long long get_peak_live_bytes()									// 上一批句子处理过程中，尚未释放的抽取器占用内存的峰值，不统计内存时为0
+		{
+			return peak_live_bytes;
+		}
+		long long get_start_live_bytes()								// 上一批句子开始抽取前所有抽取器（句法树等）占用的内存，峰值中其余部分为抽取到的规则
+		{
+			return start_live_bytes;
+		}
+
+	private:
+		bool pop_task(int worker_id,int &task_id);
+		bool steal_task(int worker_id,int &task_id);
+		void add_live_bytes(long long bytes);
+
+	private:
+		int thread_num;
+		vector<WorkerQueue> queues;
+		long long stolen_task_num;											// 被窃取的任务总数
+		long long avoided_duplicate_num;
+		long long live_bytes;												// 尚未释放的抽取器（句法树及规则）估计占用的内存
+		long long peak_live_bytes;
+		long long start_live_bytes;
+		NumaTopology *topology;
+		InstanceSink *sink;
+		bool batched_counting;
+		bool track_memory;
+		vector<CounterUpdateBuffer> update_buffers;							// 每个工作线程的批量计数缓冲区
+		long long counted_rule_num;
+		long long counter_update_num;
+		double counting_seconds;
+};
+
+#endif
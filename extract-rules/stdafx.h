@@ -13,8 +13,10 @@
 #include <algorithm>
 #include <bitset>
 #include <queue>
+#include <deque>
 #include <functional>
 #include <limits>
+#include <climits>
 
 
 #include <zlib.h>
@@ -33,5 +35,22 @@ const int MAX_SPMT_PHRASE_LEN = 5;		// 抽取SPMT规则时最大短语长度
 const int MAX_LHS_NODE_NUM = 15;		// 规则左端最大节点数
 const int MAX_RHS_WORD_NUM = 10;		// 规则右端最大单词数
 const int MAX_RULE_SIZE = 4;			// 规则最多有几个更小的规则组成
+const int MIN_NODE_NUM_FOR_PARALLEL = 256;	// 句法树节点数不少于该值时，在句子内部并行抽取规则
+const int TASK_NUM_PER_THREAD = 4;		// 句子内部并行时，平均每个线程分到的任务数
+const int SENTENCE_BATCH_SIZE = 10000;	// 每次读入并调度的句子数
+const long long DEDUP_CACHE_RECORD_NUM = 2000000;	// 重复句子缓存中最多保存的规则数
+const int MAX_NODE_NUM = 65535;			// 每个句子的句法树节点总数上限，规则用16位编号引用节点
+const int MAX_SENTENCE_LEN = 1000;		// 源端和目标端句子的最大单词数，词对齐表按此大小分配
+const size_t HUGE_PAGE_MIN_BYTES = 2*1024*1024;	// 不小于该值的数组可以使用大页，也是大页的大小
+const double MEMORY_PRESSURE_RATIO = 0.8;	// 内存使用超过上限的该比例时开始限流
+const int MIN_SENTENCE_BATCH_SIZE = 100;	// 限流时每批最少读入的句子数
+const double EXPENSIVE_SENTENCE_RATIO = 0.1;	// 不得不减小组合规则大小时，只对每批中估计代价最大的该比例的句子减小
+const size_t INSTANCE_BUFFER_BYTES = 4*1024*1024;	// 只抽取模式下每个线程缓存的规则实例字节数，写满后输出
+const int ESTIMATE_SAMPLE_SIZE = 1000;	// 估计规则表大小时默认抽样的句子数
+const int HLL_PRECISION = 14;			// HyperLogLog用哈希值的前几位选择寄存器，寄存器数为2的该次方
+const size_t OUTPUT_CHUNK_RULES = 65536;	// 输出规则表时每个线程一次格式化的规则数
+const int RADIX_BITS = 11;				// 基数排序每一趟处理的位数
+const size_t UPDATE_BUFFER_RULES = 65536;	// 批量计数时每个线程缓存的规则实例数，写满后预聚合并写入计数器
+const int UPDATE_PARTITION_BITS = 8;	// 批量计数时按键的前几位划分，每个划分能放入缓存
 
 #endif
@@ -0,0 +1,73 @@
+#include "string_interner.h"
+
+StringInterner::StringInterner()
+{
+	offsets.push_back(0);
+	slots.assign(16,-1);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 查找字符串的id，不存在时将其加入字符串池
+ 2. 入口参数: 字符串
+ 3. 出口参数: 字符串的id
+ 4. 算法简介: 线性探测的开放寻址哈希表，装载因子超过0.5时扩容
+************************************************************************************* */
+int StringInterner::intern(const string &str)
+{
+	unsigned long long h = hash_fnv1a(str.data(),str.size());
+	size_t mask = slots.size()-1;
+	size_t pos = h&mask;
+	while (slots[pos] != -1)
+	{
+		int id = slots[pos];
+		if (hashes[id] == h && equal(id,str))
+			return id;
+		pos = (pos+1)&mask;
+	}
+	int id = size();
+	arena.insert(arena.end(),str.begin(),str.end());
+	offsets.push_back(arena.size());
+	hashes.push_back(h);
+	slots[pos] = id;
+	if (2*(size_t)size() > slots.size())
+	{
+		rehash();
+	}
+	return id;
+}
+
+int StringInterner::compare(int id1,int id2) const
+{
+	size_t len1 = offsets[id1+1]-offsets[id1];
+	size_t len2 = offsets[id2+1]-offsets[id2];
+	int ret = memcmp(arena.data()+offsets[id1],arena.data()+offsets[id2],min(len1,len2));
+	if (ret != 0)
+		return ret;
+	return len1<len2? -1 : (len1>len2? 1 : 0);
+}
+
+size_t StringInterner::memory_size() const
+{
+	return arena.capacity()+offsets.capacity()*sizeof(size_t)+hashes.capacity()*sizeof(unsigned long long)+slots.capacity()*sizeof(int);
+}
+
+bool StringInterner::equal(int id,const string &str) const
+{
+	size_t len = offsets[id+1]-offsets[id];
+	return len == str.size() && memcmp(arena.data()+offsets[id],str.data(),len) == 0;
+}
+
+void StringInterner::rehash()
+{
+	slots.assign(slots.size()*2,-1);
+	size_t mask = slots.size()-1;
+	for (int id=0;id<size();id++)
+	{
+		size_t pos = hashes[id]&mask;
+		while (slots[pos] != -1)
+		{
+			pos = (pos+1)&mask;
+		}
+		slots[pos] = id;
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+#include "stdafx.h"
+#include "huge_page_allocator.h"
+#include "myutils.h"
+
+// 字符串池，每个不同的字符串只在一块连续内存中存放一次，并用从0开始的整数id表示
+class StringInterner
+{
+	public:
+		StringInterner();
+		int intern(const string &str);												// 返回字符串的id，不存在时加入
+		int size() const
+		{
+			return offsets.size()-1;
+		}
+		string get(int id) const
+		{
+			return string(arena.data()+offsets[id],offsets[id+1]-offsets[id]);
+		}
+		int compare(int id1,int id2) const;											// 按字节比较两个字符串
+		size_t memory_size() const;
+
+	private:
+		bool equal(int id,const string &str) const;
+		void rehash();
+
+	private:
+		HugePageVector<char> arena;													// 所有字符串首尾相接存放
+		HugePageVector<size_t> offsets;												// 第i个字符串为arena[offsets[i],offsets[i+1])
+		HugePageVector<unsigned long long> hashes;									// 每个字符串的哈希值，扩容时不必重新计算
+		HugePageVector<int> slots;													// 开放寻址哈希表，存放字符串id，-1表示空
+};
+
+#endif
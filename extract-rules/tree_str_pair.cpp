@@ -1,36 +1,189 @@
 #include "tree_str_pair.h"
 
-TreeStrPair::TreeStrPair(string &line_tree,string &line_str,string &line_align,map<string,double> *plex_s2t,map<string,double> *plex_t2s,RuleCounter *counter)
+TreeStrPair::TreeStrPair(string &line_tree,string &line_str,string &line_align,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s)
+{
+    lex_s2t = plex_s2t;
+    lex_t2s = plex_t2s;
+	ParsedTree tree;
+	vector<pair<int,int> > alignment;
+	string error;
+	bool valid = parse_sentence(line_tree,line_str,line_align,tree,tgt_words,alignment,error);
+	tgt_sen_len = tgt_words.size();
+	if (!valid)
+	{
+		cerr<<error<<", skip sentence\n";
+		alignment.clear();
+	}
+	load_alignment(alignment);
+	if (!valid || tree.labels.empty())
+		return;
+	roots.push_back(build_tree_from_parsed_tree(tree));
+	build_indexes();
+}
+
+/**************************************************************************************
+ 1. 函数功能: 由一个句子的多棵句法树（k-best或压缩森林展开的结果）构建共享节点的结构
+ 2. 入口参数: 各句法树的字符串及权重，目标端句子，词对齐
+ 3. 出口参数: 无
+ 4. 算法简介: 1) 逐个解析句法树，依次存放在节点数组中；任何一棵句法树与目标端句子和
+ 			     词对齐不相符时跳过整个句子
+ 			  2) 自底向上按照（标签，子节点的代表节点）合并相同的节点，由于子节点已经
+			     合并，相同的键意味着相同的子树和span
+			  3) 代表节点的权重为包含该节点的句法树的权重之和
+************************************************************************************* */
+TreeStrPair::TreeStrPair(vector<string> &lines_tree,vector<double> &tree_weights,string &line_str,string &line_align,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s)
 {
     lex_s2t = plex_s2t;
     lex_t2s = plex_t2s;
-    rule_counter = counter;
-	load_alignment(line_align);
 	tgt_words = Split(line_str);
 	tgt_sen_len = tgt_words.size();
-	if (line_tree.size() > 3)
+	vector<ParsedTree> trees;
+	vector<double> root_weights;
+	int total_node_num = 0;
+	for (int i=0;i<lines_tree.size();i++)
+	{
+		if (lines_tree.at(i).size() <= 3)
+			continue;
+		ParsedTree tree;
+		if (!parse_tree_str(lines_tree.at(i),tree))
+		{
+			cerr<<"invalid syntax tree or too many nodes, skip tree\n";
+			continue;
+		}
+		total_node_num += tree.labels.size();
+		if (total_node_num > MAX_NODE_NUM)
+		{
+			cerr<<"too many syntax tree nodes, skip remaining trees\n";
+			break;
+		}
+		trees.push_back(tree);
+		root_weights.push_back(tree_weights.at(i));
+	}
+	vector<pair<int,int> > alignment;
+	string error;
+	bool valid = parse_alignment(line_align,alignment);
+	if (!valid)
+	{
+		error = "invalid alignment";
+	}
+	for (int i=0;i<trees.size() && valid;i++)
+	{
+		valid = check_sentence(trees.at(i),tgt_words,alignment,error);
+	}
+	if (!valid)
+	{
+		cerr<<error<<", skip sentence\n";
+		alignment.clear();
+		trees.clear();
+	}
+	load_alignment(alignment);
+	unordered_map<string,int> node_table;
+	for (auto &tree : trees)
+	{
+		int tree_root = build_tree_from_parsed_tree(tree);
+		merge_tree(tree_root,node_table);
+		roots.push_back(tree_root);
+	}
+	if (roots.empty())
+		return;
+	double weight_sum = 0;													//只在实际使用的句法树之间归一化
+	for (double weight : root_weights)
+	{
+		weight_sum += weight;
+	}
+	for (double &weight : root_weights)
+	{
+		weight = weight_sum > 0? weight/weight_sum : 1.0/root_weights.size();
+	}
+	node_weights.assign(node_num(),0.0);
+	for (int i=0;i<roots.size();i++)
+	{
+		for (int node=roots.at(i);node<node_subtree_ends.at(roots.at(i));node++)
+		{
+			node_weights.at(node_canonical.at(node)) += root_weights.at(i);
+		}
+	}
+	build_indexes();
+}
+
+/**************************************************************************************
+ 1. 函数功能: 由已经解析好的句法树、目标端单词和词对齐构建句对，用于在内存中调用
+ 			  抽取库，避免写出再解析字符串
+ 2. 入口参数: 句法树，目标端单词，词对齐（源端位置，目标端位置）
+ 3. 出口参数: 无
+ 4. 算法简介: 句对不合法（见check_sentence）时不建立任何节点，该句对不抽取规则
+************************************************************************************* */
+TreeStrPair::TreeStrPair(ParsedTree &tree,vector<string> &words,vector<pair<int,int> > &alignment,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s)
+{
+    lex_s2t = plex_s2t;
+    lex_t2s = plex_t2s;
+	tgt_words = words;
+	tgt_sen_len = tgt_words.size();
+	string error;
+	if (!check_sentence(tree,words,alignment,error))
 	{
-		build_tree_from_str(line_tree);
-		check_frontier_for_nodes_in_subtree(root);
+		cerr<<error<<", skip sentence\n";
+		load_alignment(vector<pair<int,int> >());
+		return;
 	}
-	else
+	load_alignment(alignment);
+	if (tree.labels.empty())
+		return;
+	roots.push_back(build_tree_from_parsed_tree(tree));
+	build_indexes();
+}
+
+// 节点建立完成后，计算边界节点及各种索引
+void TreeStrPair::build_indexes()
+{
+	check_frontier_for_nodes();
+	build_alignment_index();
+	build_tree_index(roots.front());
+	node_rules.resize(node_num());
+	node_str_rules.resize(node_num());
+}
+
+/**************************************************************************************
+ 1. 函数功能: 为以tree_root为根的句法树中的节点寻找代表节点
+ 2. 入口参数: 句法树的根节点，已有节点的索引
+ 3. 出口参数: 无
+ 4. 算法简介: 逆先序扫描，先处理子节点，再以（标签，子节点的代表节点）为键查找已有节点
+************************************************************************************* */
+void TreeStrPair::merge_tree(int tree_root,unordered_map<string,int> &node_table)
+{
+	for (int node=node_subtree_ends.at(tree_root)-1;node>=tree_root;node--)
 	{
-		root = NULL;
+		string key = to_string(node_labels.at(node));
+		if (node_types.at(node) == 0)											//单词节点用其位置区分
+		{
+			key += " "+to_string(node_src_spans.at(node).first);
+		}
+		for (int child=node+1;child<node_subtree_ends.at(node);child=node_subtree_ends.at(child))
+		{
+			key += " "+to_string(node_canonical.at(child));
+		}
+		auto it = node_table.find(key);
+		if (it != node_table.end())
+		{
+			node_canonical.at(node) = it->second;
+		}
+		else
+		{
+			node_table[key] = node;
+		}
 	}
 }
 
-void TreeStrPair::load_alignment(const string &line_align)
+void TreeStrPair::load_alignment(const vector<pair<int,int> > &alignment)
 {
-	src_idx_to_tgt_span.resize(1000,make_pair(-1,-1));  //TODO 句子长度不安全
-	tgt_idx_to_src_span.resize(1000,make_pair(-1,-1));
-	src_idx_to_tgt_idx.resize(1000);
-	tgt_idx_to_src_idx.resize(1000);
-	vector<string> alignments = Split(line_align);
-	for (auto align : alignments)
+	src_idx_to_tgt_span.resize(MAX_SENTENCE_LEN,make_pair(-1,-1));  //词对齐已经由check_sentence检查过，不会越界
+	tgt_idx_to_src_span.resize(MAX_SENTENCE_LEN,make_pair(-1,-1));
+	src_idx_to_tgt_idx.resize(MAX_SENTENCE_LEN);
+	tgt_idx_to_src_idx.resize(MAX_SENTENCE_LEN);
+	for (auto &align : alignment)
 	{
-		vector<string> idx_pair = Split(align,"-");
-		int src_idx = stoi(idx_pair.at(0));
-		int tgt_idx = stoi(idx_pair.at(1));
+		int src_idx = align.first;
+		int tgt_idx = align.second;
 		if (src_idx_to_tgt_span.at(src_idx).first == -1 || src_idx_to_tgt_span.at(src_idx).first > tgt_idx)
 		{
 			src_idx_to_tgt_span.at(src_idx).first = tgt_idx;
@@ -53,179 +206,580 @@ void TreeStrPair::load_alignment(const string &line_align)
 }
 
 /**************************************************************************************
- 1. 函数功能: 将字符串解析成句法树
+ 1. 函数功能: 将句法树字符串解析成先序存放的节点数组，所有输入句法树字符串的入口
  2. 入口参数: 一句话的句法分析结果，Berkeley Parser格式
- 3. 出口参数: 无
- 4. 算法简介: 见注释
+ 3. 出口参数: 解析好的句法树；句法树为空、节点过多或括号不匹配时返回false，此时
+ 			  句法树为空
+ 4. 算法简介: 逐词处理括号、标签和单词，叶子节点即为源端单词
 ************************************************************************************* */
-void TreeStrPair::build_tree_from_str(const string &line_tree)
+bool TreeStrPair::parse_tree_str(const string &line_tree,ParsedTree &tree)
 {
+	tree.labels.clear();
+	tree.parents.clear();
+	if (line_tree.size() <= 3)
+		return false;
 	vector<string> toks = Split(line_tree);
-	SyntaxNode* cur_node;
-	SyntaxNode* pre_node;
-	int word_index = 0;
-	for(size_t i=0;i<toks.size();i++)
+	if (toks.size() > MAX_NODE_NUM)
+		return false;
+	auto add_node = [&](int father){
+		tree.labels.push_back("");
+		tree.parents.push_back(father);
+		return (int)tree.labels.size()-1;
+	};
+	int cur_node = -1;
+	int pre_node = -1;
+	bool valid = true;
+	for(int i=0;i<toks.size() && valid;i++)
 	{
-		//左括号情形，且去除"("作为终结符的特例(做终结符时，后继为“）”)
 		if(toks[i]=="(" && i+1<toks.size() && toks[i+1]!=")")
 		{
-			string test=toks[i];
-			if(i == 0)
-			{
-				root     = new SyntaxNode;
-				pre_node = root;
-				cur_node = root;
-			}
-			else
-			{
-				cur_node = new SyntaxNode;
-				cur_node->father = pre_node;
-				pre_node->children.push_back(cur_node);
-				pre_node = cur_node;
-			}
+			valid = pre_node != -1 || tree.labels.empty();						//只能有一个根节点
+			cur_node = add_node(pre_node);
+			pre_node = cur_node;
 		}
-		//右括号情形，去除右括号“）”做终结符的特例（做终结符时，前驱的前驱为“（,而且前驱不是")"
 		else if(toks[i]==")" && !(i-2>=0 && toks[i-2] =="(" && toks[i-1] != ")"))
 		{
-			pre_node = pre_node->father;
-			cur_node = pre_node;
+			valid = pre_node != -1;
+			if (valid)
+			{
+				pre_node = tree.parents.at(pre_node);
+				cur_node = pre_node;
+			}
 		}
-		//处理形如 （ VV 需要 ）其中VV节点这样的情形
 		else if((i-1>=0 && toks[i-1]=="(") && (i+2<toks.size() && toks[i+2]==")"))
 		{
-			cur_node->label  = toks[i];
-			cur_node         = new SyntaxNode;
-			cur_node->father = pre_node;
-			pre_node->children.push_back(cur_node);
+			valid = cur_node != -1;
+			if (valid)
+			{
+				tree.labels.at(cur_node) = toks[i];
+				cur_node = add_node(pre_node);
+			}
 		}
-		//处理形如 VP （ VV 需要 ） VP这样的节点 或 需要 这样的节点
 		else
 		{
-			cur_node->label = toks[i];
-			//如果是“需要”的情形，则记录中文词的序号
-			if(toks[i+1]==")")
+			valid = cur_node != -1;
+			if (valid)
 			{
-				cur_node->src_span = make_pair(word_index,word_index);
-				cur_node->tgt_span = src_idx_to_tgt_span.at(word_index);
-				cur_node->type = 0;
-				word_nodes.push_back(cur_node);
-				word_index++;
+				tree.labels.at(cur_node) = toks[i];
 			}
 		}
 	}
+	if (!valid || pre_node != -1 || !check_parsed_tree(tree))					//括号不匹配
+	{
+		tree.labels.clear();
+		tree.parents.clear();
+		return false;
+	}
+	return true;
 }
 
 /**************************************************************************************
- 1. 函数功能: 检查以当前子树中的每个节点是否为边界节点
- 2. 入口参数: 当前子树的根节点
- 3. 出口参数: 无
- 4. 算法简介: 1) 后序遍历当前子树
- 			  2) 根据子节点的src_span和tgt_span计算当前节点的src_span和tgt_span
-			  3) 检查tgt_span中的每个词是否都对齐到src_span中，从而确定当前节点是否为
-			     边界节点
+ 1. 函数功能: 检查已经解析好的句法树是否合法
+ 2. 入口参数: 句法树
+ 3. 出口参数: 是否合法
+ 4. 算法简介: 节点必须按照先序顺序存放，即每个节点的父节点都在从根节点到前一个节点
+ 			  的路径上
 ************************************************************************************* */
-void TreeStrPair::check_frontier_for_nodes_in_subtree(SyntaxNode* node)
+bool TreeStrPair::check_parsed_tree(const ParsedTree &tree)
 {
-	if (node->children.empty() )                                                                               // 单词节点
-		return;
-	for (const auto child : node->children)
+	if (tree.labels.empty() || tree.labels.size() != tree.parents.size() || tree.labels.size() > MAX_NODE_NUM)
+		return false;
+	if (tree.parents.front() != -1)
+		return false;
+	vector<int> open_nodes = {0};												//从根节点到前一个节点的路径
+	for (int i=1;i<tree.parents.size();i++)
+	{
+		while (!open_nodes.empty() && open_nodes.back() != tree.parents.at(i))
+		{
+			open_nodes.pop_back();
+		}
+		if (open_nodes.empty())
+			return false;
+		open_nodes.push_back(i);
+	}
+	return true;
+}
+
+// 句法树的叶子节点序列，即源端句子；先序存放，下一个节点不是子节点即为叶子
+vector<string> TreeStrPair::tree_yield(const ParsedTree &tree)
+{
+	vector<string> yield;
+	for (int i=0;i<tree.labels.size();i++)
 	{
-		check_frontier_for_nodes_in_subtree(child);
+		if (i+1 == tree.labels.size() || tree.parents.at(i+1) != i)
+		{
+			yield.push_back(tree.labels.at(i));
+		}
 	}
-	node->src_span = make_pair(node->children.front()->src_span.first,node->children.back()->src_span.second);  // 更新src_span
-	int lbound = node->children.front()->tgt_span.first;                 									    // 遍历子节点，更新tgt_span
-	int rbound = node->children.front()->tgt_span.second;
-	for (const auto child : node->children)
+	return yield;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 解析k-best输入中的一行
+ 2. 入口参数: 一行，形如"权重 ||| 句法树"或者只有句法树；权重是否为对数概率
+ 3. 出口参数: 句法树的字符串及权重，权重不是数或者不是对数概率却不为正数时返回false
+ 4. 算法简介: 没有给出权重时，概率权重为1，对数概率权重为0
+************************************************************************************* */
+bool TreeStrPair::parse_kbest_line(const string &line,bool log_weights,string &line_tree,double &weight,string &error)
+{
+	size_t pos = line.find(" ||| ");
+	if (pos == string::npos)
+	{
+		line_tree = line;
+		weight = log_weights? 0.0 : 1.0;
+		return true;
+	}
+	line_tree = line.substr(pos+5);
+	string weight_str = line.substr(0,pos);
+	char *end = NULL;
+	weight = strtod(weight_str.c_str(),&end);
+	if (weight_str.empty() || *end != '\0')
 	{
-		if (child->tgt_span.first == -1)                                                                        // 该孩子节点对空了
+		error = "invalid tree weight "+weight_str;
+		return false;
+	}
+	if (!log_weights && !(weight > 0))
+	{
+		error = "non-positive tree weight "+weight_str+", use --kbest=logprob for log probabilities";
+		return false;
+	}
+	return true;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 从一个句子的k-best句法树中选出能够使用的句法树，并归一化其权重
+ 2. 入口参数: 各句法树的字符串及权重，权重是否为对数概率
+ 3. 出口参数: 保留的句法树及归一化后的权重；各句法树的叶子节点序列不同时返回false，
+ 			  不保留任何句法树
+ 4. 算法简介: 1) 去掉为空或不能解析的句法树；节点总数超过MAX_NODE_NUM时去掉剩余的
+ 			     句法树，与构建句对时的限制相同
+			  2) 对数概率先减去最大值再取指数
+			  3) 只在保留的句法树之间归一化，使每个句子的规则次数之和为1
+************************************************************************************* */
+bool TreeStrPair::select_kbest_trees(vector<string> &lines_tree,vector<double> &tree_weights,bool log_weights,string &error)
+{
+	vector<string> kept_trees;
+	vector<double> kept_weights;
+	vector<string> first_yield;
+	int total_node_num = 0;
+	ParsedTree tree;
+	for (int i=0;i<lines_tree.size();i++)
+	{
+		if (!parse_tree_str(lines_tree.at(i),tree))
+		{
+			if (lines_tree.at(i).size() > 3)
+			{
+				cerr<<"invalid syntax tree or too many nodes, skip tree\n";
+			}
 			continue;
-		if (lbound == -1 || lbound > child->tgt_span.first)
+		}
+		total_node_num += tree.labels.size();
+		if (total_node_num > MAX_NODE_NUM)
 		{
-			lbound = child->tgt_span.first;
+			cerr<<"too many syntax tree nodes, skip remaining trees\n";
+			break;
 		}
-		if (rbound == -1 || rbound < child->tgt_span.second)
+		vector<string> yield = tree_yield(tree);
+		if (kept_trees.empty())
 		{
-			rbound = child->tgt_span.second;
+			first_yield = yield;
 		}
+		else if (yield != first_yield)
+		{
+			error = "k-best trees have different yields";
+			lines_tree.clear();
+			tree_weights.clear();
+			return false;
+		}
+		kept_trees.push_back(lines_tree.at(i));
+		kept_weights.push_back(tree_weights.at(i));
+	}
+	if (log_weights && !kept_weights.empty())
+	{
+		double max_weight = *max_element(kept_weights.begin(),kept_weights.end());
+		for (double &weight : kept_weights)
+		{
+			weight = exp(weight-max_weight);
+		}
+	}
+	double weight_sum = 0;
+	for (double weight : kept_weights)
+	{
+		weight_sum += weight;
 	}
-	node->tgt_span = make_pair(lbound,rbound);
+	for (double &weight : kept_weights)
+	{
+		weight = weight_sum > 0? weight/weight_sum : 1.0/kept_weights.size();
+	}
+	lines_tree.swap(kept_trees);
+	tree_weights.swap(kept_weights);
+	return true;
+}
+
+// 解析对齐点中的一个位置，必须是非负整数
+static bool parse_word_index(const string &str,int &idx)
+{
+	if (str.empty() || str.size() > 9 || str.find_first_not_of("0123456789") != string::npos)
+		return false;
+	idx = stoi(str);
+	return true;
+}
+
+// 将"源端位置-目标端位置"形式的词对齐解析成（源端位置，目标端位置），格式不对时返回false
+bool TreeStrPair::parse_alignment(const string &line_align,vector<pair<int,int> > &alignment)
+{
+	alignment.clear();
+	for (auto &align : Split(line_align))
+	{
+		vector<string> idx_pair = Split(align,"-");
+		int src_idx,tgt_idx;
+		if (idx_pair.size() != 2 || !parse_word_index(idx_pair.at(0),src_idx) || !parse_word_index(idx_pair.at(1),tgt_idx))
+			return false;
+		alignment.push_back(make_pair(src_idx,tgt_idx));
+	}
+	return true;
+}
 
-	int type = 1;           																					// 检查节点是否为边界节点
-	if (lbound == -1)
+/**************************************************************************************
+ 1. 函数功能: 检查一个句对能否安全地抽取规则，所有输入方式都经过这里
+ 2. 入口参数: 解析好的句法树（可以为空，此时不抽取规则），目标端单词，词对齐
+ 3. 出口参数: 是否合法，不合法时给出原因
+ 4. 算法简介: 句法树必须按先序存放，两端句子都不超过词对齐表的大小MAX_SENTENCE_LEN，
+ 			  对齐点必须在两端句子的范围内
+************************************************************************************* */
+bool TreeStrPair::check_sentence(const ParsedTree &tree,const vector<string> &tgt_words,const vector<pair<int,int> > &alignment,string &error)
+{
+	if (tree.labels.empty())
+		return true;
+	if (!check_parsed_tree(tree))
 	{
-		type = 2;
+		error = "invalid parsed tree";
+		return false;
 	}
-	else
+	int src_sen_len = tree_yield(tree).size();
+	if (src_sen_len > MAX_SENTENCE_LEN || tgt_words.size() > MAX_SENTENCE_LEN)
 	{
-		for (int tgt_idx=lbound; tgt_idx<=rbound; tgt_idx++)
+		error = "sentence longer than "+to_string(MAX_SENTENCE_LEN)+" words";
+		return false;
+	}
+	for (auto &align : alignment)
+	{
+		if (align.first < 0 || align.first >= src_sen_len || align.second < 0 || align.second >= tgt_words.size())
+		{
+			error = "alignment point "+to_string(align.first)+"-"+to_string(align.second)+" out of range";
+			return false;
+		}
+	}
+	return true;
+}
+
+// 解析并检查字符串形式的句对；句法树为空时合法，但不抽取规则
+bool TreeStrPair::parse_sentence(const string &line_tree,const string &line_str,const string &line_align,
+								 ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,string &error)
+{
+	tgt_words = Split(line_str);
+	if (!parse_tree_str(line_tree,tree) && line_tree.size() > 3)
+	{
+		error = "invalid syntax tree or too many nodes";
+		return false;
+	}
+	if (!parse_alignment(line_align,alignment))
+	{
+		error = "invalid alignment";
+		return false;
+	}
+	return check_sentence(tree,tgt_words,alignment,error);
+}
+
+/**************************************************************************************
+ 1. 函数功能: 将已经解析好的句法树追加到节点数组的末尾
+ 2. 入口参数: 合法的句法树
+ 3. 出口参数: 句法树根节点的编号
+ 4. 算法简介: 叶子节点按照从左到右的顺序作为源端单词
+************************************************************************************* */
+int TreeStrPair::build_tree_from_parsed_tree(const ParsedTree &tree)
+{
+	get_label_id("");
+	int tree_root = node_num();
+	for (int i=0;i<tree.labels.size();i++)
+	{
+		int father = tree.parents.at(i) == -1? -1 : tree_root+tree.parents.at(i);
+		int node = add_node(father);
+		node_labels.at(node) = get_label_id(tree.labels.at(i));
+	}
+	link_tree(tree_root);
+	int word_index = 0;
+	for (int node=tree_root;node<node_num();node++)
+	{
+		if (node_child_nums.at(node) > 0)
+			continue;
+		node_src_spans.at(node) = make_pair(word_index,word_index);
+		node_tgt_spans.at(node) = src_idx_to_tgt_span.at(word_index);
+		node_types.at(node) = 0;
+		if (roots.empty())
 		{
-			if (tgt_idx_to_src_idx.at(tgt_idx).size() <= 1)
+			word_nodes.push_back(node);
+		}
+		word_index++;
+	}
+	return tree_root;
+}
+
+// 由父节点编号计算以tree_root为根的句法树中每个节点的子树结尾和孩子个数
+void TreeStrPair::link_tree(int tree_root)
+{
+	for (int node=node_num()-1;node>tree_root;node--)						//节点按先序编号，逆序扫描即可由孩子得到父节点的子树结尾
+	{
+		int father = node_parents.at(node);
+		node_subtree_ends.at(father) = max(node_subtree_ends.at(father),node_subtree_ends.at(node));
+		node_child_nums.at(father)++;
+	}
+}
+
+int TreeStrPair::add_node(int father)
+{
+	int node = node_num();
+	node_labels.push_back(0);
+	node_parents.push_back(father);
+	node_subtree_ends.push_back(node+1);
+	node_child_nums.push_back(0);
+	node_src_spans.push_back(make_pair(-1,-1));
+	node_tgt_spans.push_back(make_pair(-1,-1));
+	node_types.push_back(-1);
+	node_canonical.push_back(node);
+	node_weights.push_back(1.0);
+	return node;
+}
+
+int TreeStrPair::get_label_id(const string &label)
+{
+	auto it = label_ids.find(label);
+	if (it != label_ids.end())
+		return it->second;
+	int label_id = labels.size();
+	labels.push_back(label);
+	label_ids[label] = label_id;
+	return label_id;
+}
+
+/**************************************************************************************
+ 1. 函数功能: 检查每个节点是否为边界节点
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 1) 按句法树的顺序，对每棵句法树逆先序扫描，保证孩子节点先于父节点处理
+ 			  2) k-best输入时非代表节点的代表节点在之前的句法树中，已经处理过，子树相同，
+			     直接复制其span和类型
+ 			  3) 根据子节点的src_span和tgt_span计算当前节点的src_span和tgt_span
+			  4) 检查tgt_span中的每个词是否都对齐到src_span中，从而确定当前节点是否为
+			     边界节点
+************************************************************************************* */
+void TreeStrPair::check_frontier_for_nodes()
+{
+	for (int tree_root : roots)
+	{
+		check_frontier_for_tree(tree_root);
+	}
+}
+
+void TreeStrPair::check_frontier_for_tree(int tree_root)
+{
+	for (int node=node_subtree_ends.at(tree_root)-1;node>=tree_root;node--)
+	{
+		if (node_types.at(node) == 0)                                                                      // 单词节点
+			continue;
+		int canonical = node_canonical.at(node);
+		if (canonical != node)
+		{
+			node_src_spans.at(node) = node_src_spans.at(canonical);
+			node_tgt_spans.at(node) = node_tgt_spans.at(canonical);
+			node_types.at(node) = node_types.at(canonical);
+			continue;
+		}
+		int first_child = node+1;
+		int last_child = first_child;
+		int lbound = node_tgt_spans.at(first_child).first;                 							    // 遍历子节点，更新tgt_span
+		int rbound = node_tgt_spans.at(first_child).second;
+		for (int child=first_child;child<node_subtree_ends.at(node);child=node_subtree_ends.at(child))
+		{
+			last_child = child;
+			if (node_tgt_spans.at(child).first == -1)                                                      // 该孩子节点对空了
 				continue;
-			for (int src_idx : tgt_idx_to_src_idx.at(tgt_idx))
+			if (lbound == -1 || lbound > node_tgt_spans.at(child).first)
+			{
+				lbound = node_tgt_spans.at(child).first;
+			}
+			if (rbound == -1 || rbound < node_tgt_spans.at(child).second)
+			{
+				rbound = node_tgt_spans.at(child).second;
+			}
+		}
+		pair<int,int> src_span = make_pair(node_src_spans.at(first_child).first,node_src_spans.at(last_child).second);
+		node_src_spans.at(node) = src_span;																// 更新src_span
+		node_tgt_spans.at(node) = make_pair(lbound,rbound);
+
+		int type = 1;           																		// 检查节点是否为边界节点
+		if (lbound == -1)
+		{
+			type = 2;
+		}
+		else
+		{
+			for (int tgt_idx=lbound; tgt_idx<=rbound; tgt_idx++)
 			{
-				if (src_idx < node->src_span.first || src_idx > node->src_span.second) 						 // 目标语言单词对到了src_span外面
+				if (tgt_idx_to_src_idx.at(tgt_idx).size() <= 1)
+					continue;
+				for (int src_idx : tgt_idx_to_src_idx.at(tgt_idx))
 				{
-					type = 2;
-					goto end;
+					if (src_idx < src_span.first || src_idx > src_span.second) 							 // 目标语言单词对到了src_span外面
+					{
+						type = 2;
+						goto end;
+					}
 				}
 			}
 		}
-	}
 end:
-	node->type = type;
+		node_types.at(node) = type;
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 对词对齐建立用于O(1)区间查询的索引
+ 2. 入口参数: 无
+ 3. 出口参数: 无
+ 4. 算法简介: 对源端（目标端）每个单词对齐到的另一端的左右边界分别建立区间最小值
+ 			  和最大值表，未对齐的单词不参与比较
+************************************************************************************* */
+void TreeStrPair::build_alignment_index()
+{
+	int src_sen_len = word_nodes.size();
+	vector<int> lbounds(tgt_sen_len),rbounds(tgt_sen_len);
+	for (int i=0;i<tgt_sen_len;i++)
+	{
+		lbounds.at(i) = tgt_idx_to_src_span.at(i).first == -1? INT_MAX : tgt_idx_to_src_span.at(i).first;
+		rbounds.at(i) = tgt_idx_to_src_span.at(i).second;
+	}
+	tgt_to_src_lbound_table.build(lbounds,true);
+	tgt_to_src_rbound_table.build(rbounds,false);
+
+	lbounds.resize(src_sen_len);
+	rbounds.resize(src_sen_len);
+	for (int i=0;i<src_sen_len;i++)
+	{
+		lbounds.at(i) = src_idx_to_tgt_span.at(i).first == -1? INT_MAX : src_idx_to_tgt_span.at(i).first;
+		rbounds.at(i) = src_idx_to_tgt_span.at(i).second;
+	}
+	src_to_tgt_lbound_table.build(lbounds,true);
+	src_to_tgt_rbound_table.build(rbounds,false);
 }
 
-void TreeStrPair::dump_all_rules(SyntaxNode* node)
+/**************************************************************************************
+ 1. 函数功能: 对一棵句法树建立最低公共祖先索引
+ 2. 入口参数: 句法树的根节点
+ 3. 出口参数: 无
+ 4. 算法简介: 对句法树做欧拉遍历，在深度序列上建立稀疏表，将最低公共祖先查询
+ 			  转化为区间最小值查询；k-best输入时每次只对一棵句法树建立索引
+************************************************************************************* */
+void TreeStrPair::build_tree_index(int tree_root)
 {
-	if (node == NULL)
-		return;
-	for (auto rule : node->rules)
+	euler_nodes.clear();
+	euler_depths.clear();
+	word_euler_idx.assign(word_nodes.size(),-1);
+	build_euler_tour(tree_root,0);
+	euler_depth_table.build(euler_depths,true);
+}
+
+void TreeStrPair::build_euler_tour(int node,int depth)
+{
+	if (node_types.at(node) == 0)
+	{
+		word_euler_idx.at(node_src_spans.at(node).first) = euler_nodes.size();
+	}
+	euler_nodes.push_back(node);
+	euler_depths.push_back(depth);
+	for (int child=node+1;child<node_subtree_ends.at(node);child=node_subtree_ends.at(child))
 	{
-		dump_rule(rule);
+		build_euler_tour(child,depth+1);
+		euler_nodes.push_back(node);
+		euler_depths.push_back(depth);
 	}
-	for (const auto &child : node->children)
+}
+
+/**************************************************************************************
+ 1. 函数功能: 寻找能覆盖源端span的最低句法节点
+ 2. 入口参数: 源端span
+ 3. 出口参数: 覆盖该span的最低非单词节点
+ 4. 算法简介: span首尾两个单词节点的最低公共祖先即为所求；若span只含一个单词，
+ 			  则返回该单词的词性节点，即其父节点
+************************************************************************************* */
+int TreeStrPair::find_lowest_covering_node(pair<int,int> src_span)
+{
+	int lbound = word_euler_idx.at(src_span.first);
+	int rbound = word_euler_idx.at(src_span.second);
+	int node = euler_nodes.at(euler_depth_table.query_idx(lbound,rbound));
+	if (node_types.at(node) == 0)
 	{
-		dump_all_rules(child);
+		node = node_parents.at(node);
 	}
+	return node;
 }
 
-void TreeStrPair::dump_rule(Rule &rule)
+void TreeStrPair::dump_all_rules(vector<RuleRecord> &rule_records)
 {
-	string src_side = rule.src_tree_frag.at(0)->label + " ";
+	for (int node=0;node<node_num();node++)
+	{
+		for (auto &rule : node_rules.at(node))						//只有代表节点上有规则
+		{
+			dump_rule(rule,rule_records);
+		}
+	}
+}
+
+/**************************************************************************************
+ 1. 函数功能: 查询词汇翻译概率
+ 2. 入口参数: 词汇翻译表，以空格分隔的词对
+ 3. 出口参数: 翻译概率，词对不在表中时为0
+ 4. 算法简介: 词汇翻译表被多个线程共享，因此只查找不插入
+************************************************************************************* */
+double TreeStrPair::lookup_lex_weight(const map<string,double> *lex_table,const string &word_pair)
+{
+	auto it = lex_table->find(word_pair);
+	if (it == lex_table->end())
+		return 0.0;
+	return it->second;
+}
+
+void TreeStrPair::dump_rule(Rule &rule,vector<RuleRecord> &rule_records)
+{
+	int root = rule.src_tree_frag.at(0);
+	string src_side = label_of(root) + " ";
     double lex_weight_t2s = 1.0;
     bool word_in_src_side = false;
     double lex_weight_s2null = 1.0;
-	for (int i=1;i<rule.src_tree_frag.size();i++)
+	vector<int> open_child_nums = {node_child_nums.at(root)};				//从根节点到当前节点的路径上，每个内部节点还没有输出的孩子数
+	for (int i=1;i<rule.src_tree_frag.size();i++)								//规则片段中的内部节点包含其所有孩子，因此由孩子数即可确定括号
 	{
-		if (rule.src_tree_frag.at(i-1) != rule.src_tree_frag.at(i)->father)			//前一个节点不是当前节点的父节点
-		{
-			SyntaxNode* node = rule.src_tree_frag.at(i-1);
-			while(node != rule.src_tree_frag.at(i)->father)							//沿着前一个节点往上走，直到走到当前节点的父节点
-			{
-				src_side += ") ";
-				node = node->father;
-			}
-		}
+		int node = rule.src_tree_frag.at(i);
 		src_side += "( ";		
 		if (rule.src_node_status.at(i) < 0)											//规则源端内部节点或者单词节点
 		{
-			src_side += rule.src_tree_frag.at(i)->label + " ";
+			src_side += label_of(node) + " ";
             if (rule.src_node_status.at(i) == -3)                                   //计算源端单词节点的词汇权重
             {
                 word_in_src_side = true;
                 double lex_weight_for_one_word = 0;
-                string src_word = rule.src_tree_frag.at(i)->label;
-                int src_idx = rule.src_tree_frag.at(i)->src_span.first;
+                const string &src_word = label_of(node);
+                int src_idx = node_src_spans.at(node).first;
                 if (src_idx_to_tgt_idx.at(src_idx).empty())
                 {
-                    lex_weight_for_one_word = (*lex_t2s)[src_word+" NULL"];         //该词汇翻译对必然存在于词汇翻译表中
-                    lex_weight_s2null *= (*lex_s2t)["NULL "+src_word];
+                    lex_weight_for_one_word = lookup_lex_weight(lex_t2s,src_word+" NULL");         //该词汇翻译对必然存在于词汇翻译表中
+                    lex_weight_s2null *= lookup_lex_weight(lex_s2t,"NULL "+src_word);
                 }
                 else
                 {
                     for (int tgt_idx : src_idx_to_tgt_idx.at(src_idx))
                     {
-                        lex_weight_for_one_word += (*lex_t2s)[src_word+" "+tgt_words.at(tgt_idx)];
+                        lex_weight_for_one_word += lookup_lex_weight(lex_t2s,src_word+" "+tgt_words.at(tgt_idx));
                     }
                     lex_weight_for_one_word /= src_idx_to_tgt_idx.at(src_idx).size();
                 }
@@ -234,14 +788,21 @@ void TreeStrPair::dump_rule(Rule &rule)
 		}
 		else 																		//规则源端变量节点
 		{
-			src_side += "x"+to_string(rule.src_node_status.at(i))+":"+rule.src_tree_frag.at(i)->label+" ";
+			src_side += "x"+to_string(rule.src_node_status.at(i))+":"+label_of(node)+" ";
+		}
+		if (rule.src_node_status.at(i) == -2)										//内部节点，等待输出其孩子
+		{
+			open_child_nums.push_back(node_child_nums.at(node));
+			continue;
 		}
-	}
-	SyntaxNode* node = rule.src_tree_frag.back();
-	while (node != rule.src_tree_frag.front())										//补齐剩下的右括号
-	{
 		src_side += ") ";
-		node = node->father;
+		while (--open_child_nums.back() == 0)										//沿着当前节点往上走，补齐已输出全部孩子的节点的右括号
+		{
+			open_child_nums.pop_back();
+			if (open_child_nums.empty())											//根节点没有括号
+				break;
+			src_side += ") ";
+		}
 	}
 	string tgt_side;
     double lex_weight_s2t = 1.0;
@@ -258,14 +819,14 @@ void TreeStrPair::dump_rule(Rule &rule)
             string tgt_word = tgt_words.at(tgt_idx);
             if (tgt_idx_to_src_idx.at(tgt_idx).empty())
             {
-                lex_weight_for_one_word = (*lex_s2t)[tgt_word+" NULL"];             //该词汇翻译对必然存在于词汇翻译表中
-                lex_weight_t2null *= (*lex_t2s)["NULL "+tgt_word];
+                lex_weight_for_one_word = lookup_lex_weight(lex_s2t,tgt_word+" NULL");             //该词汇翻译对必然存在于词汇翻译表中
+                lex_weight_t2null *= lookup_lex_weight(lex_t2s,"NULL "+tgt_word);
             }
             else
             {
                 for (int src_idx : tgt_idx_to_src_idx.at(tgt_idx))
                 {
-                    lex_weight_for_one_word += (*lex_s2t)[tgt_word+" "+word_nodes.at(src_idx)->label];
+                    lex_weight_for_one_word += lookup_lex_weight(lex_s2t,tgt_word+" "+label_of(word_nodes.at(src_idx)));
                 }
                 lex_weight_for_one_word = lex_weight_for_one_word/tgt_idx_to_src_idx.at(tgt_idx).size();
             }
@@ -300,11 +861,64 @@ void TreeStrPair::dump_rule(Rule &rule)
         lex_weight_s2t = lex_weight_s2null;
     }
 	string str_rule = src_side + " ||| " + tgt_side;
-	auto it = rule.src_tree_frag.front()->str_rules.find(str_rule);
-	if (it == rule.src_tree_frag.front()->str_rules.end())
+	int canonical_root = node_canonical.at(root);
+	auto it = node_str_rules.at(canonical_root).find(str_rule);
+	if (it == node_str_rules.at(canonical_root).end())
 	{
-		//rule_counter->update(src_side,tgt_side,lex_weight_s2t,lex_weight_t2s);		//每个节点上的规则不重复
-		rule.src_tree_frag.front()->str_rules.insert(str_rule);
+		rule_records.push_back({src_side,tgt_side,lex_weight_s2t,lex_weight_t2s,node_weights.at(canonical_root),rule.type});	//每个节点上的规则不重复
+		node_str_rules.at(canonical_root).insert(str_rule);
 	}
 }
 
+
+/**************************************************************************************
+ 1. 函数功能: 估计当前句子占用的内存字节数
+ 2. 入口参数: 无
+ 3. 出口参数: 字节数
+ 4. 算法简介: 按各数组的容量累加，规则及规则字符串按每个元素的实际大小累加，
+ 			  不计入内存分配器本身的开销
+************************************************************************************* */
+size_t TreeStrPair::memory_size()
+{
+	size_t bytes = sizeof(*this);
+	bytes += (roots.capacity()+node_labels.capacity()+node_parents.capacity()+node_subtree_ends.capacity()+node_child_nums.capacity()
+			  +node_canonical.capacity()+word_nodes.capacity()+euler_nodes.capacity()+euler_depths.capacity()+word_euler_idx.capacity())*sizeof(int);
+	bytes += (node_src_spans.capacity()+node_tgt_spans.capacity()+src_idx_to_tgt_span.capacity()+tgt_idx_to_src_span.capacity())*sizeof(pair<int,int>);
+	bytes += node_types.capacity()+node_weights.capacity()*sizeof(double);
+	for (auto &idxs : src_idx_to_tgt_idx)
+	{
+		bytes += sizeof(idxs)+idxs.capacity()*sizeof(int);
+	}
+	for (auto &idxs : tgt_idx_to_src_idx)
+	{
+		bytes += sizeof(idxs)+idxs.capacity()*sizeof(int);
+	}
+	for (auto &label : labels)
+	{
+		bytes += sizeof(label)+label.capacity();
+	}
+	for (auto &word : tgt_words)
+	{
+		bytes += sizeof(word)+word.capacity();
+	}
+	for (auto &rules : node_rules)
+	{
+		bytes += sizeof(rules)+(rules.capacity()-rules.size())*sizeof(Rule);
+		for (auto &rule : rules)
+		{
+			bytes += sizeof(Rule)+rule.src_tree_frag.capacity()*sizeof(unsigned short)+(rule.src_node_status.capacity()+rule.tgt_word_status.capacity())*sizeof(int)
+					 +rule.src_node_span.capacity()*sizeof(pair<int,int>);
+		}
+	}
+	for (auto &str_rules : node_str_rules)
+	{
+		bytes += sizeof(str_rules);
+		for (auto &str_rule : str_rules)
+		{
+			bytes += sizeof(str_rule)+str_rule.capacity()+4*sizeof(void*);			// 红黑树节点的指针和颜色
+		}
+	}
+	bytes += euler_depth_table.memory_size()+tgt_to_src_lbound_table.memory_size()+tgt_to_src_rbound_table.memory_size()
+			 +src_to_tgt_lbound_table.memory_size()+src_to_tgt_rbound_table.memory_size();
+	return bytes;
+}
@@ -3,12 +3,11 @@
 #include "stdafx.h"
 #include "myutils.h"
 #include "rule_counter.h"
-
-struct SyntaxNode;
+#include "range_query.h"
 
 struct Rule
 {
-	vector<SyntaxNode*> src_tree_frag;			//按照先序顺序记录规则源端句法树片段中的节点
+	vector<unsigned short> src_tree_frag;		//按照先序顺序记录规则源端句法树片段中的节点编号
 	vector<int> src_node_status;				//记录规则源端每个节点的状态，i表示第i个变量节点，-1表示根节点，-2表示内部节点，-3表示单词节点
 	vector<pair<int,int> > src_node_span;  		//记录规则源端每个节点在目标端的span
 	vector<int> tgt_word_status;				//记录目标端span中每个单词的状态，i表示被源端第i个变量替换，-1表示没被替换
@@ -18,71 +17,103 @@ struct Rule
 	int type;                                   //规则类型，1为最小规则，2为扩展了未对齐单词的最小规则，3为SMPT规则，4为组合规则
 	int size;                            	    //规则大小，表示规则由几个最小规则组合而成
 	int tgt_word_num;
+	int last_expanded_idx;						//组合规则最后一次被替换的变量节点在src_tree_frag中的位置，之前的变量不再扩展
+	bool order_sensitive;						//组合规则用到的某条规则的变量span相交，替换顺序会影响结果
 	Rule ()
 	{
 		variable_num = 0;
 		type = 1;
 		size = 1;
 		tgt_word_num = 0;
+		last_expanded_idx = 0;
+		order_sensitive = false;
 	}
 };
 
-// 源端句法树节点
-struct SyntaxNode
+// 已经解析好的句法树，节点按照先序顺序存放，叶子节点为源端单词
+struct ParsedTree
 {
-	string label;                                   // 该节点的句法标签或者词
-	SyntaxNode* father;
-	vector<SyntaxNode*> children;
-	pair<int,int> src_span;                         // 该节点对应的源端span,用首位两个单词的位置表示
-	pair<int,int> tgt_span;                         // 该节点对应的目标端span
-	int type;                                       // 节点类型，0：单词节点，1：边界节点，2：非边界节点
-	vector<Rule> rules;								// 该节点能抽取的所有规则
-	set<string> str_rules;							// 该节点所有规则的字符串形式
-	
-	SyntaxNode ()
-	{
-		father   = NULL;
-		src_span = make_pair(-1,-1);
-		tgt_span = make_pair(-1,-1);
-		type     = -1;
-	}
-	~SyntaxNode ()
-	{
-		for (auto node : children)
-		{
-			delete node;
-		}
-	}
+	vector<string> labels;						// 每个节点的句法标签或者词
+	vector<int> parents;						// 每个节点的父节点编号，根节点为-1
 };
 
+/*
+ * 源端句法树按照先序顺序存放在连续的数组中（结构数组），节点用编号表示，节点i的子树
+ * 占据编号区间[i,node_subtree_ends[i])，第一个孩子为i+1，下一个兄弟为其子树的结尾，
+ * 因此对子树的遍历是线性扫描。k-best输入时每棵句法树各占一段连续编号，多棵句法树中
+ * 相同的节点以第一次出现的编号作为代表，规则、规则字符串和权重只记录在代表节点上。
+ */
 class TreeStrPair
 {
 	public:
-		TreeStrPair(string &line_tree,string &line_str,string &line_align,map<string,double> *plex_s2t,map<string,double> *plex_t2s,RuleCounter *counter);
-		~TreeStrPair()
-		{
-			delete root;
-		}
-		void dump_all_rules(SyntaxNode* node);
-		void dump_rule(Rule &rule);
+		TreeStrPair(string &line_tree,string &line_str,string &line_align,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s);
+		TreeStrPair(vector<string> &lines_tree,vector<double> &tree_weights,string &line_str,string &line_align,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s);
+		TreeStrPair(ParsedTree &tree,vector<string> &words,vector<pair<int,int> > &alignment,const map<string,double> *plex_s2t,const map<string,double> *plex_t2s);
+		void dump_all_rules(vector<RuleRecord> &rule_records);
+		void dump_rule(Rule &rule,vector<RuleRecord> &rule_records);
+		void build_tree_index(int tree_root);
+		int find_lowest_covering_node(pair<int,int> src_span);
+		int node_num() {return node_labels.size();}
+		const string& label_of(int node) {return labels.at(node_labels.at(node));}
+		size_t memory_size();
+		static bool parse_tree_str(const string &line_tree,ParsedTree &tree);
+		static bool parse_alignment(const string &line_align,vector<pair<int,int> > &alignment);
+		static vector<string> tree_yield(const ParsedTree &tree);
+		static bool parse_kbest_line(const string &line,bool log_weights,string &line_tree,double &weight,string &error);
+		static bool select_kbest_trees(vector<string> &lines_tree,vector<double> &tree_weights,bool log_weights,string &error);
+		static bool check_sentence(const ParsedTree &tree,const vector<string> &tgt_words,const vector<pair<int,int> > &alignment,string &error);
+		static bool parse_sentence(const string &line_tree,const string &line_str,const string &line_align,
+								   ParsedTree &tree,vector<string> &tgt_words,vector<pair<int,int> > &alignment,string &error);
 
 	private:
-		void load_alignment(const string &align_line);
-		void build_tree_from_str(const string &line_of_tree);
-		void check_frontier_for_nodes_in_subtree(SyntaxNode* node);
+		void load_alignment(const vector<pair<int,int> > &alignment);
+		int build_tree_from_parsed_tree(const ParsedTree &tree);
+		static bool check_parsed_tree(const ParsedTree &tree);
+		void link_tree(int tree_root);
+		void build_indexes();
+		int add_node(int father);
+		int get_label_id(const string &label);
+		void check_frontier_for_nodes();
+		void check_frontier_for_tree(int tree_root);
+		void merge_tree(int tree_root,unordered_map<string,int> &node_table);
+		void build_alignment_index();
+		void build_euler_tour(int node,int depth);
+		double lookup_lex_weight(const map<string,double> *lex_table,const string &word_pair);
 
 	public:
-        RuleCounter *rule_counter;
-		SyntaxNode* root;
-        vector<SyntaxNode*> word_nodes;
+		vector<int> roots;													// 每棵句法树的根节点，k-best输入时各句法树依次存放
+		vector<int> node_labels;											// 节点的句法标签或者词在labels中的编号
+		vector<int> node_parents;											// 父节点编号，根节点为-1
+		vector<int> node_subtree_ends;										// 子树结尾的后一个编号
+		vector<int> node_child_nums;										// 孩子节点的个数
+		vector<pair<int,int> > node_src_spans;								// 节点对应的源端span,用首位两个单词的位置表示
+		vector<pair<int,int> > node_tgt_spans;								// 节点对应的目标端span
+		vector<char> node_types;											// 节点类型，0：单词节点，1：边界节点，2：非边界节点
+		vector<int> node_canonical;											// 代表节点的编号，1-best输入时为节点自身
+		vector<double> node_weights;										// 包含该节点的句法树的权重之和，作为该节点上规则的（分数）次数
+		vector<vector<Rule> > node_rules;									// 代表节点能抽取的所有规则
+		vector<set<string> > node_str_rules;								// 代表节点所有规则的字符串形式
+		vector<string> labels;												// 句子中出现的所有句法标签和词
+		vector<int> word_nodes;												// 第一棵句法树中每个源端单词对应的节点
 		vector<pair<int,int> > src_idx_to_tgt_span;   						// 记录每个源语言单词对应的目标端span
 		vector<pair<int,int> > tgt_idx_to_src_span;   						// 记录每个目标语言单词对应的源端span
 		vector<vector<int> > src_idx_to_tgt_idx;     					    // 记录每个源语言单词对应的目标端单词位置
 		vector<vector<int> > tgt_idx_to_src_idx;      						// 记录每个目标语言单词对应的源端单词位置
 		vector<string> tgt_words;
 		int tgt_sen_len;
-        map<string,double> *lex_s2t;
-        map<string,double> *lex_t2s;
+		vector<int> euler_nodes;   											// 句法树的欧拉序列，用于求最低公共祖先
+		vector<int> euler_depths;          									// 欧拉序列中每个节点的深度
+		vector<int> word_euler_idx;        									// 每个单词节点在欧拉序列中第一次出现的位置
+		SparseTable euler_depth_table;     									// 欧拉序列深度的区间最小值表
+		SparseTable tgt_to_src_lbound_table;								// 目标端区间内单词对应的源端最左位置
+		SparseTable tgt_to_src_rbound_table;								// 目标端区间内单词对应的源端最右位置
+		SparseTable src_to_tgt_lbound_table;								// 源端区间内单词对应的目标端最左位置
+		SparseTable src_to_tgt_rbound_table;								// 源端区间内单词对应的目标端最右位置
+        const map<string,double> *lex_s2t;
+        const map<string,double> *lex_t2s;
+
+	private:
+		unordered_map<string,int> label_ids;
 };
 
 #endif
@@ -0,0 +1,106 @@
+#include "batch_extractor.h"
+
+/**************************************************************************************
+ BatchExtractor接口的示例和测试
+ 用法: batch_test 句法树文件 目标端句子文件 词对齐文件 源到目标词汇翻译表 目标到源词汇翻译表 [线程数]
+ 同一批句对分别以字符串形式和预先解析好的形式输入，检查两者得到的规则表完全相同，
+ 再按照dump_rules的格式输出规则表，应与命令行程序a的输出完全相同
+************************************************************************************* */
+
+// 多线程时各线程计数器的合并顺序不固定，累加的浮点数可能在最后几位上不同
+static bool same_value(double a,double b)
+{
+	return fabs(a-b) <= 1e-9*max(fabs(a),fabs(b));
+}
+
+static bool same_rule(const ScoredRule &a,const ScoredRule &b)
+{
+	return a.rule_src == b.rule_src && a.rule_tgt == b.rule_tgt && same_value(a.count,b.count) && same_value(a.root2rule_prob,b.root2rule_prob)
+		&& same_value(a.trans_prob_t2s,b.trans_prob_t2s) && same_value(a.trans_prob_s2t,b.trans_prob_s2t)
+		&& same_value(a.lex_weight_t2s,b.lex_weight_t2s) && same_value(a.lex_weight_s2t,b.lex_weight_s2t);
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 6)
+	{
+		cerr<<"usage: batch_test tree_file str_file align_file lex_s2t lex_t2s [thread_num]\n";
+		return 1;
+	}
+	int thread_num = argc > 6? stoi(argv[6]) : 1;
+	LexTable lex_table;
+	lex_table.load(argv[4],argv[5]);
+	BatchExtractor triple_extractor(&lex_table,thread_num);					// 两个抽取器共享同一个只读的词汇翻译表
+	BatchExtractor parsed_extractor(&lex_table,thread_num);
+
+	ifstream ft(argv[1]),fs(argv[2]),fa(argv[3]);
+	vector<SentenceTriple> triples;
+	vector<ParsedSentence> parsed_sentences;
+	ParsedSentence bad_sentence;											// 词对齐越界的句子，应当被拒绝而不是使程序退出
+	int invalid_num = 0;
+	SentenceTriple triple;
+	while (getline(ft,triple.tree))
+	{
+		getline(fs,triple.str);
+		getline(fa,triple.align);
+		TrimLine(triple.tree);
+		TrimLine(triple.str);
+		TrimLine(triple.align);
+		ParsedSentence parsed;
+		string error;
+		if (!TreeStrPair::parse_sentence(triple.tree,triple.str,triple.align,parsed.tree,parsed.tgt_words,parsed.alignment,error))
+		{
+			parsed.tree = ParsedTree();											// 与字符串输入一样跳过不合法的句子
+		}
+		else if (bad_sentence.tree.labels.empty() && !parsed.tree.labels.empty())
+		{
+			bad_sentence = parsed;
+			bad_sentence.alignment.push_back(make_pair((int)parsed.tree.labels.size(),(int)parsed.tgt_words.size()));
+		}
+		triples.push_back(triple);
+		parsed_sentences.push_back(parsed);
+		if (triples.size() == SENTENCE_BATCH_SIZE)								// 每批句子抽取后累加到计数器中，不必一次读入整个语料
+		{
+			invalid_num += triple_extractor.count(triples);
+			parsed_extractor.count(parsed_sentences);
+			triples.clear();
+			parsed_sentences.clear();
+		}
+	}
+	invalid_num += triple_extractor.count(triples);
+	parsed_extractor.count(parsed_sentences);
+	if (!bad_sentence.tree.labels.empty())
+	{
+		vector<ParsedSentence> bad_sentences(1,bad_sentence);
+		vector<vector<RuleRecord> > rule_batches;
+		vector<string> errors;
+		if (parsed_extractor.extract(bad_sentences,rule_batches,&errors) != 1 || errors.at(0).empty() || !rule_batches.at(0).empty())
+		{
+			cerr<<"FAILED: sentence with out-of-range alignment was not rejected\n";
+			return 1;
+		}
+		cerr<<"invalid sentence rejected: "<<errors.at(0)<<endl;
+	}
+
+	RuleCounter *triple_counter = triple_extractor.get_counter();
+	vector<ScoredRule> triple_rules,parsed_rules;
+	triple_counter->collect_rules(triple_rules);
+	parsed_extractor.get_counter()->collect_rules(parsed_rules);
+	if (triple_rules.size() != parsed_rules.size())
+	{
+		cerr<<"FAILED: "<<triple_rules.size()<<" rules from strings, "<<parsed_rules.size()<<" rules from parsed sentences\n";
+		return 1;
+	}
+	for (size_t i=0;i<triple_rules.size();i++)
+	{
+		if (!same_rule(triple_rules.at(i),parsed_rules.at(i)))
+		{
+			cerr<<"FAILED: rule "<<i<<" differs: "<<triple_rules.at(i).rule_src<<" ||| "<<triple_rules.at(i).rule_tgt
+				<<" vs "<<parsed_rules.at(i).rule_src<<" ||| "<<parsed_rules.at(i).rule_tgt<<endl;
+			return 1;
+		}
+	}
+	cerr<<triple_rules.size()<<" rules, string and parsed input agree, "<<invalid_num<<" invalid sentences skipped\n";
+	triple_counter->dump_rules();
+	return 0;
+}